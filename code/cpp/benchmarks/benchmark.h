@@ -0,0 +1,119 @@
+#pragma once
+
+// Minimal benchmark harness following Google Benchmark's interface and JSON output format,
+// so results can be tracked with the same tools without depending on the library.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace bench {
+    // Keeps value (and the computation producing it) from being optimized away
+    template <typename T>
+    inline void DoNotOptimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#endif
+    }
+
+    class State {
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            uint64_t _iterations;
+            Clock::time_point _startTime;
+            Clock::duration _elapsed{0};
+
+        public:
+            // Custom results reported next to the timings, e.g. nodes searched
+            std::map<std::string, double> counters;
+
+            explicit State(uint64_t iterations) : _iterations(iterations) {}
+
+            inline uint64_t iterations() const {return _iterations;}
+            inline double getElapsedSeconds() const {return std::chrono::duration<double>(_elapsed).count();}
+
+            // Excludes setup inside the loop from the timing
+            inline void PauseTiming() {_elapsed += Clock::now() - _startTime;}
+            inline void ResumeTiming() {_startTime = Clock::now();}
+
+            // for (auto _ : state) runs the loop body iterations() times between the timer start and stop
+            struct [[maybe_unused]] Value {};
+
+            class Iterator {
+                private:
+                    State* _state;
+                    uint64_t _remaining;
+
+                public:
+                    Iterator(State* state, uint64_t remaining) : _state(state), _remaining(remaining) {}
+
+                    inline Value operator*() const {return Value();}
+                    inline Iterator& operator++() {
+                        --_remaining;
+                        return *this;
+                    }
+                    inline bool operator!=(const Iterator&) const {
+                        if (_remaining != 0) {
+                            return true;
+                        }
+                        _state->PauseTiming();
+                        return false;
+                    }
+            };
+
+            inline Iterator begin() {
+                ResumeTiming();
+                return Iterator(this, _iterations);
+            }
+            inline Iterator end() {return Iterator(this, 0);}
+    };
+
+    class Benchmark {
+        private:
+            std::string _name;
+            std::function<void(State&)> _function;
+            uint64_t _iterations = 0;
+
+        public:
+            Benchmark(std::string name, std::function<void(State&)> function) : _name(std::move(name)), _function(std::move(function)) {}
+
+            // Runs exactly this many iterations instead of as many as fit in the minimum time
+            inline Benchmark* Iterations(uint64_t iterations) {
+                _iterations = iterations;
+                return this;
+            }
+
+            inline const std::string& getName() const {return _name;}
+            inline uint64_t getIterations() const {return _iterations;}
+            inline void run(State& state) const {_function(state);}
+    };
+
+    Benchmark* RegisterBenchmark(const std::string& name, std::function<void(State&)> function);
+    const std::vector<Benchmark*>& getBenchmarks();
+}
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+
+#define BENCHMARK(function) \
+    static bench::Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) = bench::RegisterBenchmark(#function, function)
+
+// Registers function(state, args...) under the name function/testCase
+#define BENCHMARK_CAPTURE(function, testCase, ...) \
+    static bench::Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) = bench::RegisterBenchmark( \
+        #function "/" #testCase, [](bench::State& state) {function(state, __VA_ARGS__);})
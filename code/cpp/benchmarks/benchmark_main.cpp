@@ -0,0 +1,185 @@
+// Runs the registered benchmarks.
+//
+// Usage: connect4_benchmark [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>]
+//                           [--benchmark_format=<console|json>] [--benchmark_out=<json file>]
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+using namespace bench;
+
+
+namespace {
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        double realTimeNS;
+        std::map<std::string, double> counters;
+    };
+
+    struct Options {
+        std::string filter = ".";
+        double minTime = 0.5;
+        bool json = false;
+        std::string outPath;
+    };
+
+    std::vector<Benchmark*>& getRegistry() {
+        static std::vector<Benchmark*> benchmarks;
+        return benchmarks;
+    }
+
+    bool parseFlag(const char* arg, const char* name, std::string& value) {
+        const size_t length = std::strlen(name);
+        if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+            return false;
+        }
+        value = arg + length + 1;
+        return true;
+    }
+
+    Result runBenchmark(const Benchmark& benchmark, double minTime) {
+        uint64_t iterations = benchmark.getIterations() != 0 ? benchmark.getIterations() : 1;
+
+        while (true) {
+            State state(iterations);
+            benchmark.run(state);
+
+            const double seconds = state.getElapsedSeconds();
+            if (benchmark.getIterations() != 0 || seconds >= minTime || iterations >= 1000000000) {
+                return {benchmark.getName(), iterations, seconds * 1e9 / static_cast<double>(iterations), state.counters};
+            }
+
+            // Aim past the minimum time, growing at most tenfold when the first runs are too short to time
+            double multiplier = seconds > 0.0 ? minTime * 1.4 / seconds : 10.0;
+            multiplier = std::min(std::max(multiplier, 2.0), 10.0);
+            iterations = static_cast<uint64_t>(static_cast<double>(iterations) * multiplier);
+        }
+    }
+
+    std::string escapeJSON(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void writeJSON(std::ostream& out, const char* executable, const std::vector<Result>& results) {
+        char date[64];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"date\": \"" << date << "\",\n";
+        out << "    \"executable\": \"" << escapeJSON(executable) << "\",\n";
+        out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+        out << "    \"library_build_type\": \"release\"\n";
+#else
+        out << "    \"library_build_type\": \"debug\"\n";
+#endif
+        out << "  },\n";
+        out << "  \"benchmarks\": [\n";
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            out << "    {\n";
+            out << "      \"name\": \"" << escapeJSON(result.name) << "\",\n";
+            out << "      \"run_name\": \"" << escapeJSON(result.name) << "\",\n";
+            out << "      \"run_type\": \"iteration\",\n";
+            out << "      \"iterations\": " << result.iterations << ",\n";
+            out << "      \"real_time\": " << result.realTimeNS << ",\n";
+            for (const std::pair<const std::string, double>& counter : result.counters) {
+                out << "      \"" << escapeJSON(counter.first) << "\": " << counter.second << ",\n";
+            }
+            out << "      \"time_unit\": \"ns\"\n";
+            out << (i + 1 < results.size() ? "    },\n" : "    }\n");
+        }
+
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+    void writeConsole(const Result& result) {
+        std::printf("%-40s %15.1f ns %12llu", result.name.c_str(), result.realTimeNS, static_cast<unsigned long long>(result.iterations));
+        for (const std::pair<const std::string, double>& counter : result.counters) {
+            std::printf(" %s=%g", counter.first.c_str(), counter.second);
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+}
+
+
+Benchmark* bench::RegisterBenchmark(const std::string& name, std::function<void(State&)> function) {
+    getRegistry().push_back(new Benchmark(name, std::move(function)));
+    return getRegistry().back();
+}
+
+
+const std::vector<Benchmark*>& bench::getBenchmarks() {
+    return getRegistry();
+}
+
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        if (parseFlag(argv[i], "--benchmark_filter", value)) {
+            options.filter = value;
+        } else if (parseFlag(argv[i], "--benchmark_min_time", value)) {
+            options.minTime = std::atof(value.c_str());
+        } else if (parseFlag(argv[i], "--benchmark_format", value)) {
+            options.json = value == "json";
+        } else if (parseFlag(argv[i], "--benchmark_out", value)) {
+            options.outPath = value;
+        } else {
+            std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    const std::regex filter(options.filter);
+    std::vector<Result> results;
+    for (const Benchmark* benchmark : getBenchmarks()) {
+        if (!std::regex_search(benchmark->getName(), filter)) {
+            continue;
+        }
+
+        results.push_back(runBenchmark(*benchmark, options.minTime));
+        if (!options.json) {
+            writeConsole(results.back());
+        }
+    }
+
+    if (options.json) {
+        writeJSON(std::cout, argv[0], results);
+    }
+
+    if (!options.outPath.empty()) {
+        std::ofstream out(options.outPath);
+        if (!out) {
+            std::fprintf(stderr, "Failed to write %s\n", options.outPath.c_str());
+            return 1;
+        }
+        writeJSON(out, argv[0], results);
+    }
+
+    return 0;
+}
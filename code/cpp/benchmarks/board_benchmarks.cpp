@@ -0,0 +1,196 @@
+// Microbenchmarks of the Board primitives used at every search node, and of their batch kernels.
+
+#include "benchmark.h"
+
+#include <connect4/board.h>
+#include <connect4/board_batch.h>
+
+#include <random>
+#include <vector>
+
+using namespace connect4;
+
+
+namespace {
+    // Random positions cycled through by every benchmark, so no result can be computed at compile time
+    constexpr size_t NUM_BOARDS = 4096;
+
+    struct BoardSample {
+        Board board;
+        uint8_t col;
+    };
+
+    const std::vector<BoardSample>& getSamples() {
+        static const std::vector<BoardSample> samples = []() {
+            std::mt19937 rng(42);
+            std::vector<BoardSample> samples;
+            while (samples.size() < NUM_BOARDS) {
+                Board board;
+                const int numMoves = static_cast<int>(rng() % 36);
+                for (int i = 0; i < numMoves && !board.opponentWins(); ++i) {
+                    uint8_t col;
+                    do {
+                        col = static_cast<uint8_t>(rng() % 7);
+                    } while (board.isColumnFull(col));
+                    board.placePlayer(col);
+                    board = board.getSwapped();
+                }
+
+                uint8_t col;
+                do {
+                    col = static_cast<uint8_t>(rng() % 7);
+                } while (board.isColumnFull(col));
+                samples.push_back({board, col});
+            }
+            return samples;
+        }();
+        return samples;
+    }
+
+    template <typename Function>
+    void runOverSamples(bench::State& state, Function function) {
+        const std::vector<BoardSample>& samples = getSamples();
+        size_t i = 0;
+        for (auto _ : state) {
+            function(samples[i]);
+            i = (i + 1) & (NUM_BOARDS - 1);
+        }
+    }
+
+    // Runs function on a batch of every sample per iteration, with the kernel of instructionSet
+    template <typename Function>
+    void runOverBatch(bench::State& state, BoardBatch::InstructionSet instructionSet, Function function) {
+        const BoardBatch::InstructionSet defaultInstructionSet = BoardBatch::getInstructionSet();
+        if (!BoardBatch::setInstructionSet(instructionSet)) {
+            state.counters["unsupported"] = 1;
+            return;
+        }
+
+        BoardBatch batch;
+        for (const BoardSample& sample : getSamples()) {
+            batch.push(sample.board);
+        }
+
+        for (auto _ : state) {
+            function(batch);
+        }
+        BoardBatch::setInstructionSet(defaultInstructionSet);
+
+        const double seconds = state.getElapsedSeconds();
+        const double boards = static_cast<double>(NUM_BOARDS) * static_cast<double>(state.iterations());
+        state.counters["boards_per_second"] = seconds > 0.0 ? boards / seconds : 0.0;
+    }
+}
+
+
+static void Board_placePlayer(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        Board board = sample.board;
+        board.placePlayer(sample.col);
+        bench::DoNotOptimize(board);
+    });
+}
+BENCHMARK(Board_placePlayer);
+
+
+static void Board_playerWins(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bench::DoNotOptimize(sample.board.playerWins());
+    });
+}
+BENCHMARK(Board_playerWins);
+
+
+static void Board_isDraw(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bench::DoNotOptimize(sample.board.isDraw());
+    });
+}
+BENCHMARK(Board_isDraw);
+
+
+static void Board_getPossibleMoves(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bench::DoNotOptimize(sample.board.getPossibleMoves());
+    });
+}
+BENCHMARK(Board_getPossibleMoves);
+
+
+static void Board_getPlayerWinningCells(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bench::DoNotOptimize(sample.board.getPlayerWinningCells());
+    });
+}
+BENCHMARK(Board_getPlayerWinningCells);
+
+
+static void Board_getPlayerNonLosingMoves(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bench::DoNotOptimize(sample.board.getPlayerNonLosingMoves());
+    });
+}
+BENCHMARK(Board_getPlayerNonLosingMoves);
+
+
+static void Board_getKey(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bench::DoNotOptimize(sample.board.getKey());
+    });
+}
+BENCHMARK(Board_getKey);
+
+
+static void Board_getCanonicalKey(bench::State& state) {
+    runOverSamples(state, [](const BoardSample& sample) {
+        bool isMirrored;
+        bench::DoNotOptimize(sample.board.getCanonicalKey(isMirrored));
+        bench::DoNotOptimize(isMirrored);
+    });
+}
+BENCHMARK(Board_getCanonicalKey);
+
+
+static void BoardHash_hash(bench::State& state) {
+    const BoardHash hash;
+    runOverSamples(state, [&hash](const BoardSample& sample) {
+        bench::DoNotOptimize(hash(sample.board));
+    });
+}
+BENCHMARK(BoardHash_hash);
+
+
+static void BoardBatch_getPlayerWins(bench::State& state, BoardBatch::InstructionSet instructionSet) {
+    static bool wins[NUM_BOARDS];
+    runOverBatch(state, instructionSet, [](const BoardBatch& batch) {
+        batch.getPlayerWins(wins);
+        bench::DoNotOptimize(wins);
+    });
+}
+BENCHMARK_CAPTURE(BoardBatch_getPlayerWins, scalar, BoardBatch::SCALAR);
+BENCHMARK_CAPTURE(BoardBatch_getPlayerWins, avx2, BoardBatch::AVX2);
+BENCHMARK_CAPTURE(BoardBatch_getPlayerWins, avx512, BoardBatch::AVX512);
+
+
+static void BoardBatch_getPlayerWinningCells(bench::State& state, BoardBatch::InstructionSet instructionSet) {
+    static uint64_t cells[NUM_BOARDS];
+    runOverBatch(state, instructionSet, [](const BoardBatch& batch) {
+        batch.getPlayerWinningCells(cells);
+        bench::DoNotOptimize(cells);
+    });
+}
+BENCHMARK_CAPTURE(BoardBatch_getPlayerWinningCells, scalar, BoardBatch::SCALAR);
+BENCHMARK_CAPTURE(BoardBatch_getPlayerWinningCells, avx2, BoardBatch::AVX2);
+BENCHMARK_CAPTURE(BoardBatch_getPlayerWinningCells, avx512, BoardBatch::AVX512);
+
+
+static void BoardBatch_getPossibleMoves(bench::State& state, BoardBatch::InstructionSet instructionSet) {
+    static uint64_t moves[NUM_BOARDS];
+    runOverBatch(state, instructionSet, [](const BoardBatch& batch) {
+        batch.getPossibleMoves(moves);
+        bench::DoNotOptimize(moves);
+    });
+}
+BENCHMARK_CAPTURE(BoardBatch_getPossibleMoves, scalar, BoardBatch::SCALAR);
+BENCHMARK_CAPTURE(BoardBatch_getPossibleMoves, avx2, BoardBatch::AVX2);
+BENCHMARK_CAPTURE(BoardBatch_getPossibleMoves, avx512, BoardBatch::AVX512);
@@ -0,0 +1,155 @@
+// Search benchmarks over the easy, medium and hard test positions, each run once with an empty memo.
+
+#include "benchmark.h"
+#include "test_positions.h"
+
+#include <connect4/endgame_table.h>
+#include <connect4/player.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace connect4;
+
+
+// Horizon of the fixed-depth search benchmarks
+static constexpr uint8_t SEARCH_DEPTH = 12;
+
+// Horizon of the endgame table benchmark, short of the end of the game so the evaluation is used
+static constexpr uint8_t ENDGAME_TABLE_SEARCH_DEPTH = 4;
+
+
+static void setSearchCounters(bench::State& state, const Player& player, uint64_t nodes, size_t numPositions) {
+    const double seconds = state.getElapsedSeconds();
+    const TranspositionTable::Stats stats = player.getMemoStats();
+
+    state.counters["positions"] = static_cast<double>(numPositions);
+    state.counters["nodes"] = static_cast<double>(nodes);
+    state.counters["nodes_per_second"] = seconds > 0.0 ? static_cast<double>(nodes) / seconds : 0.0;
+    state.counters["tt_probes"] = static_cast<double>(stats.probes);
+    state.counters["tt_hit_rate"] = stats.getHitRate();
+    state.counters["tt_collisions"] = static_cast<double>(stats.collisions);
+}
+
+
+// Scores of every column of each position up to SEARCH_DEPTH, on a single thread
+static void Search_fixedDepth(bench::State& state, const std::vector<Board>& boards) {
+    Player player;
+    for (auto _ : state) {
+        bench::DoNotOptimize(player.analyze(boards, SEARCH_DEPTH, 0, 1));
+    }
+
+    setSearchCounters(state, player, player.getNodeCount(), boards.size());
+    state.counters["first_move_cutoff_rate"] = player.getSearchStats().getFirstMoveCutoffRate();
+}
+BENCHMARK_CAPTURE(Search_fixedDepth, easy, bench::parsePositions(bench::EASY_POSITIONS))->Iterations(1);
+BENCHMARK_CAPTURE(Search_fixedDepth, medium, bench::parsePositions(bench::MEDIUM_POSITIONS))->Iterations(1);
+BENCHMARK_CAPTURE(Search_fixedDepth, hard, bench::parsePositions(bench::HARD_POSITIONS))->Iterations(1);
+
+
+// Exact score of each position, the memo is shared by the positions of a set
+static void Search_solve(bench::State& state, const std::vector<Board>& boards) {
+    Player player;
+    uint64_t nodes = 0;
+    for (auto _ : state) {
+        for (const Board& board : boards) {
+            bench::DoNotOptimize(player.solve(board));
+            nodes += player.getNodeCount();
+        }
+    }
+
+    setSearchCounters(state, player, nodes, boards.size());
+    state.counters["time_to_solve_ms"] = state.getElapsedSeconds() * 1000.0 / static_cast<double>(boards.size());
+}
+BENCHMARK_CAPTURE(Search_solve, easy, bench::parsePositions(bench::EASY_POSITIONS))->Iterations(1);
+BENCHMARK_CAPTURE(Search_solve, medium, bench::parsePositions(bench::MEDIUM_POSITIONS))->Iterations(1);
+BENCHMARK_CAPTURE(Search_solve, hard, bench::parsePositions(bench::HARD_POSITIONS))->Iterations(1);
+
+
+// Writes an endgame table sampled along the best move of board: the exact scores of the positions two plies
+// after that move, so the search's other moves are left to the evaluation
+static void writeSampledEndgameTable(Player& solver, const Board& board, const std::string& path) {
+    uint8_t bestCol = 0;
+    int8_t bestScore = MIN_SCORE;
+    for (uint8_t col = 0; col < 7; ++col) {
+        if (board.isColumnFull(col)) {
+            continue;
+        }
+
+        Board child = board;
+        child.placePlayer(col);
+        const int8_t score = child.playerWins() ? MAX_SCORE : static_cast<int8_t>(-solver.solve(child.getSwapped()));
+        if (score > bestScore) {
+            bestCol = col;
+            bestScore = score;
+        }
+    }
+
+    // Side to move after the best move, as the player stones
+    Board reply = board;
+    reply.placePlayer(bestCol);
+    reply = reply.getSwapped();
+
+    std::vector<std::pair<uint64_t, int8_t>> entries;
+    for (uint8_t col = 0; col < 7; ++col) {
+        if (reply.isColumnFull(col)) {
+            continue;
+        }
+
+        Board next = reply;
+        next.placePlayer(col);
+        if (!next.playerWins() && !next.isDraw()) {
+            bool isMirrored;
+            next = next.getSwapped();
+            entries.emplace_back(next.getCanonicalKey(isMirrored), solver.solve(next));
+        }
+    }
+
+    const uint8_t ply = static_cast<uint8_t>(utils::popCount(board.getTotalBoard()));
+    EndgameTable::write(path, static_cast<uint8_t>(42 - (ply + 2)), std::move(entries));
+}
+
+
+// Scores of every column of each position up to ENDGAME_TABLE_SEARCH_DEPTH, with a table sampled along the
+// position's best move. The tables are written to the temporary directory before the timing starts.
+static void Search_endgameTable(bench::State& state, const std::vector<Board>& boards) {
+    std::random_device random;
+    const std::string pathPrefix = (std::filesystem::temp_directory_path() / ("endgame_table_benchmark_" + std::to_string(random()) + "_")).string();
+
+    Player solver;
+    std::vector<std::string> paths;
+    std::vector<std::unique_ptr<Player>> players;
+    for (size_t i = 0; i < boards.size(); ++i) {
+        paths.push_back(pathPrefix + std::to_string(i) + ".bin");
+        writeSampledEndgameTable(solver, boards[i], paths.back());
+
+        players.emplace_back(new Player());
+        players.back()->loadEndgameTable(paths.back());
+    }
+
+    uint64_t nodes = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < boards.size(); ++i) {
+            bench::DoNotOptimize(players[i]->analyze({boards[i]}, ENDGAME_TABLE_SEARCH_DEPTH, 0, 1));
+            nodes += players[i]->getNodeCount();
+        }
+    }
+
+    // The players unmap their tables before the files are removed
+    players.clear();
+    for (const std::string& path : paths) {
+        std::remove(path.c_str());
+    }
+
+    const double seconds = state.getElapsedSeconds();
+    state.counters["positions"] = static_cast<double>(boards.size());
+    state.counters["nodes"] = static_cast<double>(nodes);
+    state.counters["nodes_per_second"] = seconds > 0.0 ? static_cast<double>(nodes) / seconds : 0.0;
+    state.counters["time_per_position_us"] = seconds * 1e6 / static_cast<double>(boards.size() * state.iterations());
+}
+BENCHMARK_CAPTURE(Search_endgameTable, easy, bench::parsePositions(bench::EASY_POSITIONS))->Iterations(1);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <connect4/board.h>
+
+#include <vector>
+
+
+namespace bench {
+    // Positions given as the columns played from the empty board (1 to 7), with the side to move
+    // neither winning with its next stone nor forced to lose to the other side's. Easy endgames
+    // solve in well under a millisecond, medium ones in milliseconds and hard ones in about 0.1 to 1 s.
+    static const char* const EASY_POSITIONS[] = {
+        "531544344267637257266533",
+        "226654543317564672756645",
+        "466642314456225242416321",
+        "146411733741151353254445",
+        "275166237775513312254647666451",
+        "335711112752244445324216316764",
+        "763363276437425663362552527511",
+        "145444626624665573521654517232"
+    };
+
+    static const char* const MEDIUM_POSITIONS[] = {
+        "225333251631626421",
+        "323262111427136471",
+        "631137547511153413",
+        "667453432575523543",
+        "236114622456443161",
+        "3541121416737241526165",
+        "2577115571332432137364",
+        "2275732671466716452164"
+    };
+
+    static const char* const HARD_POSITIONS[] = {
+        "15576365365",
+        "54535675571",
+        "16714523432",
+        "34265656641",
+        "73467713425",
+        "64451735617717",
+        "35441267772217",
+        "33641331264313"
+    };
+
+    // Board with the stones of the side to move as the player stones
+    inline connect4::Board parsePosition(const char* moves) {
+        connect4::Board board;
+        for (const char* move = moves; *move; ++move) {
+            board.placePlayer(static_cast<uint8_t>(*move - '1'));
+            board = board.getSwapped();
+        }
+        return board;
+    }
+
+    template <size_t N>
+    inline std::vector<connect4::Board> parsePositions(const char* const (&positions)[N]) {
+        std::vector<connect4::Board> boards;
+        for (const char* moves : positions) {
+            boards.push_back(parsePosition(moves));
+        }
+        return boards;
+    }
+}
@@ -1,67 +1,185 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 
 namespace connect4 {
     class Board {
+        public:
+            // Bit boards are stored column-wise from the bottom left, 7 bits per column.
+            // The top bit of each column is an always empty sentinel row, so shifted
+            // alignments can never wrap from one column into the next.
+            static constexpr uint8_t WIDTH = 7;
+            static constexpr uint8_t HEIGHT = 6;
+            static constexpr uint8_t COLUMN_BITS = HEIGHT + 1;
+
+            // Lowest cell of every column
+            static constexpr uint64_t BOTTOM_MASK = 0x0000040810204081ULL;
+            // Every playable cell (all columns, sentinel row excluded)
+            static constexpr uint64_t BOARD_MASK = BOTTOM_MASK * ((1ULL << HEIGHT) - 1);
+
+            static constexpr uint64_t bottomMask(uint8_t col) {return 1ULL << (COLUMN_BITS * col);}
+            static constexpr uint64_t topMask(uint8_t col) {return 1ULL << (COLUMN_BITS * col + HEIGHT - 1);}
+            static constexpr uint64_t columnMask(uint8_t col) {return ((1ULL << HEIGHT) - 1) << (COLUMN_BITS * col);}
+
+            // Reverses the column order of a bit board (including the sentinel row), i.e. mirrors it left to right
+            static constexpr uint64_t mirror(uint64_t bits) {
+                return ((bits & _columnBits(0)) << (6 * COLUMN_BITS))
+                    | ((bits & _columnBits(1)) << (4 * COLUMN_BITS))
+                    | ((bits & _columnBits(2)) << (2 * COLUMN_BITS))
+                    | (bits & _columnBits(3))
+                    | ((bits & _columnBits(4)) >> (2 * COLUMN_BITS))
+                    | ((bits & _columnBits(5)) >> (4 * COLUMN_BITS))
+                    | ((bits & _columnBits(6)) >> (6 * COLUMN_BITS));
+            }
+
         private:
-            // Bit boards are stored column-wise from the bottom left
             uint64_t _totalBoard;
             uint64_t _playerBoard;
+            // The same stones mirrored left to right. Every move updates both orientations,
+            // so the canonical key costs two additions instead of mirroring the key.
+            uint64_t _mirroredTotalBoard;
+            uint64_t _mirroredPlayerBoard;
+
+            static constexpr uint64_t _columnBits(uint8_t col) {return ((1ULL << COLUMN_BITS) - 1) << (COLUMN_BITS * col);}
+
+            // Cell indices exposed to callers are 6 * col + row, the bit index of the previous
+            // 6-bit-per-column encoding; convert them to the internal 7-bit layout
+            static constexpr uint8_t _toBit(uint8_t index) {return index + index / HEIGHT;}
+
+            // Adding the column's bottom bit carries up to the first empty cell of that column.
+            // Masking with the column keeps a full column unchanged (the carry lands on the sentinel).
+            static inline uint64_t _place(uint64_t total, uint8_t col) {
+                return total | ((total + bottomMask(col)) & columnMask(col));
+            }
+
+            // Cells completing three stones along one direction, the missing cell may be at either end or inside
+            static inline uint64_t _getAlignedCells(uint64_t stones, uint8_t shift) {
+                uint64_t pair = (stones << shift) & (stones << (2 * shift));
+                uint64_t cells = pair & (stones << (3 * shift));
+                cells |= pair & (stones >> shift);
+                pair = (stones >> shift) & (stones >> (2 * shift));
+                cells |= pair & (stones << shift);
+                cells |= pair & (stones >> (3 * shift));
+                return cells;
+            }
+
         public:
-            Board() : _totalBoard(0), _playerBoard(0) {}
+            Board() : _totalBoard(0), _playerBoard(0), _mirroredTotalBoard(0), _mirroredPlayerBoard(0) {}
+
+            // Whether the stones hold four in a row
+            static inline bool isWin(uint64_t board) {
+                // Horizontal
+                uint64_t m = board & (board >> COLUMN_BITS);
+                if (m & (m >> (2 * COLUMN_BITS))) return true;
+
+                // Diagonal (top-left to bottom-right)
+                m = board & (board >> (COLUMN_BITS - 1));
+                if (m & (m >> (2 * (COLUMN_BITS - 1)))) return true;
+
+                // Diagonal (bottom-left to top-right)
+                m = board & (board >> (COLUMN_BITS + 1));
+                if (m & (m >> (2 * (COLUMN_BITS + 1)))) return true;
+
+                // Vertical
+                m = board & (board >> 1);
+                return (m & (m >> 2)) != 0;
+            }
+
+            // Empty cells that would complete four in a row for the side owning stones
+            static inline uint64_t getWinningCells(uint64_t stones, uint64_t total) {
+                // Vertical
+                uint64_t cells = (stones << 1) & (stones << 2) & (stones << 3);
+
+                // Horizontal and both diagonals
+                cells |= _getAlignedCells(stones, COLUMN_BITS);
+                cells |= _getAlignedCells(stones, COLUMN_BITS - 1);
+                cells |= _getAlignedCells(stones, COLUMN_BITS + 1);
+
+                return cells & (BOARD_MASK ^ total);
+            }
+
+            // Moves that do not let the other side win with its next stone: a cell the other side would win on
+            // must be taken, two such cells cannot both be blocked, and no stone may go right below one of them
+            static inline uint64_t getNonLosingMoves(uint64_t possibleMoves, uint64_t otherWinningCells) {
+                uint64_t forcedMoves = possibleMoves & otherWinningCells;
+                if (forcedMoves) {
+                    if (forcedMoves & (forcedMoves - 1)) {
+                        return 0;
+                    }
+                    possibleMoves = forcedMoves;
+                }
+                return possibleMoves & ~(otherWinningCells >> 1);
+            }
+
+            // Builds a board from the previous 6-bit-per-column encoding (e.g. saved positions)
+            static Board fromLegacy(uint64_t totalBoard, uint64_t playerBoard);
+            uint64_t getLegacyTotalBoard() const;
+            uint64_t getLegacyPlayerBoard() const;
 
             inline uint64_t getTotalBoard() const {return _totalBoard;}
             inline uint64_t getPlayerBoard() const {return _playerBoard;}
             inline uint64_t getOpponentBoard() const {return _totalBoard ^ _playerBoard;}
 
-            inline bool isFilled(uint8_t index) const {return (_totalBoard >> index) & 0x1ULL;}
-            inline bool isPlayer(uint8_t index) const {return (_playerBoard >> index) & 0x1ULL;}
-            inline bool isOpponent(uint8_t index) const {return (getOpponentBoard() >> index) & 0x1ULL;}
+            inline bool isFilled(uint8_t index) const {return (_totalBoard >> _toBit(index)) & 0x1ULL;}
+            inline bool isPlayer(uint8_t index) const {return (_playerBoard >> _toBit(index)) & 0x1ULL;}
+            inline bool isOpponent(uint8_t index) const {return (getOpponentBoard() >> _toBit(index)) & 0x1ULL;}
 
             inline void setPlayer(uint8_t index) {
-                _totalBoard |= (0x1ULL << index);
-                _playerBoard |= (0x1ULL << index);
+                const uint64_t cell = 0x1ULL << _toBit(index);
+                _totalBoard |= cell;
+                _playerBoard |= cell;
+                _mirroredTotalBoard |= mirror(cell);
+                _mirroredPlayerBoard |= mirror(cell);
             }
 
             inline void setOpponent(uint8_t index) {
-                _totalBoard |= (0x1ULL << index);
+                const uint64_t cell = 0x1ULL << _toBit(index);
+                _totalBoard |= cell;
+                _mirroredTotalBoard |= mirror(cell);
             }
 
             inline void clear(uint8_t index) {
-                _totalBoard &= ~(0x1ULL << index);
-                _playerBoard &= ~(0x1ULL << index);
+                const uint64_t cell = 0x1ULL << _toBit(index);
+                _totalBoard &= ~cell;
+                _playerBoard &= ~cell;
+                _mirroredTotalBoard &= ~mirror(cell);
+                _mirroredPlayerBoard &= ~mirror(cell);
             }
 
             inline void reset() {
                 _totalBoard = 0;
                 _playerBoard = 0;
+                _mirroredTotalBoard = 0;
+                _mirroredPlayerBoard = 0;
             }
 
             inline void placePlayer(uint8_t col) {
-                uint8_t idx = 6 * col;
-                for (uint8_t i = 0; i < 6; ++i) {
-                    if (!isFilled(idx)) {
-                        setPlayer(idx);
-                        return;
-                    }
-                    ++idx;
-                }
+                uint64_t newTotal = _place(_totalBoard, col);
+                _playerBoard |= newTotal ^ _totalBoard;
+                _totalBoard = newTotal;
+
+                newTotal = _place(_mirroredTotalBoard, WIDTH - 1 - col);
+                _mirroredPlayerBoard |= newTotal ^ _mirroredTotalBoard;
+                _mirroredTotalBoard = newTotal;
             }
 
             inline void placeOpponent(uint8_t col) {
-                uint8_t idx = 6 * col;
-                for (uint8_t i = 0; i < 6; ++i) {
-                    if (!isFilled(idx)) {
-                        setOpponent(idx);
-                        return;
-                    }
-                    ++idx;
-                }
+                _totalBoard = _place(_totalBoard, col);
+                _mirroredTotalBoard = _place(_mirroredTotalBoard, WIDTH - 1 - col);
             }
 
-            inline bool isColumnFull(uint8_t col) const {return isFilled(6 * col + 5);}
+            inline bool isColumnFull(uint8_t col) const {return (_totalBoard & topMask(col)) != 0;}
+
+            // Lowest empty cell of every column that is not full
+            inline uint64_t getPossibleMoves() const {return (_totalBoard + BOTTOM_MASK) & BOARD_MASK;}
+            inline uint64_t getPlayerWinningCells() const {return getWinningCells(_playerBoard, _totalBoard);}
+            inline uint64_t getOpponentWinningCells() const {return getWinningCells(getOpponentBoard(), _totalBoard);}
+
+            // Moves of the side about to play that do not hand the other side an immediate win
+            inline uint64_t getPlayerNonLosingMoves() const {return getNonLosingMoves(getPossibleMoves(), getOpponentWinningCells());}
+            inline uint64_t getOpponentNonLosingMoves() const {return getNonLosingMoves(getPossibleMoves(), getPlayerWinningCells());}
 
             inline bool operator==(const Board& other) const {
                 return _totalBoard == other._totalBoard && _playerBoard == other._playerBoard;
@@ -71,11 +189,44 @@ namespace connect4 {
                 return !(*this == other);
             }
 
-            bool playerWins() const;
-            bool opponentWins() const;
+            inline bool playerWins() const {return isWin(_playerBoard);}
+            inline bool opponentWins() const {return isWin(getOpponentBoard());}
+
+            inline bool isDraw() const {return _totalBoard == BOARD_MASK;}
 
-            // 2 ^ 42 - 1 == 4398046511103ULL
-            inline bool isDraw() const {return _totalBoard == 4398046511103ULL;}
+            // Unique 49-bit key: adding the bottom row on top of the filled cells sets one bit just
+            // above each column's stones, which marks the column height, and keeps the player bits below it
+            inline uint64_t getKey() const {return _playerBoard + _totalBoard + BOTTOM_MASK;}
+            // Key of the mirrored position, equal to mirror(getKey()) as the carries stay within each column
+            inline uint64_t getMirroredKey() const {return _mirroredPlayerBoard + _mirroredTotalBoard + BOTTOM_MASK;}
+
+            // Mirrored positions have the same score, so both share the smaller of their two keys.
+            // isMirrored tells whether columns of the canonical key run in reverse (col -> WIDTH - 1 - col).
+            inline uint64_t getCanonicalKey(bool& isMirrored) const {
+                const uint64_t key = getKey();
+                const uint64_t mirroredKey = getMirroredKey();
+                isMirrored = mirroredKey < key;
+                return isMirrored ? mirroredKey : key;
+            }
+
+            // Same position with the player and opponent stones exchanged
+            inline Board getSwapped() const {
+                Board board;
+                board._totalBoard = _totalBoard;
+                board._playerBoard = getOpponentBoard();
+                board._mirroredTotalBoard = _mirroredTotalBoard;
+                board._mirroredPlayerBoard = _mirroredTotalBoard ^ _mirroredPlayerBoard;
+                return board;
+            }
+
+            inline Board getMirrored() const {
+                Board board;
+                board._totalBoard = _mirroredTotalBoard;
+                board._playerBoard = _mirroredPlayerBoard;
+                board._mirroredTotalBoard = _totalBoard;
+                board._mirroredPlayerBoard = _playerBoard;
+                return board;
+            }
     };
 
     struct BoardHash {
@@ -86,10 +237,9 @@ namespace connect4 {
             return key ^ (key >> 31);
         }
 
+        // The key already identifies the board, so a single mix spreads it
         size_t operator()(const Board& board) const noexcept {
-            uint64_t h1 = splitMix64(board.getTotalBoard());
-            uint64_t h2 = splitMix64(board.getPlayerBoard());
-            return static_cast<size_t>(h1 ^ (h2 + 0x9e3779b97f4a7c15ULL + (h1 << 6) + (h2 >> 2)));
+            return static_cast<size_t>(splitMix64(board.getKey()));
         }
     };
 }
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <connect4/board.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace connect4 {
+    // Boards stored as a structure of arrays, so a check made on every board of a batch runs on
+    // several boards per instruction. The kernel is picked once for the CPU running the program.
+    class BoardBatch {
+        public:
+            enum InstructionSet : uint8_t {
+                SCALAR = 0,
+                // 4 boards per instruction
+                AVX2 = 1,
+                // 8 boards per instruction
+                AVX512 = 2
+            };
+
+        private:
+            std::vector<uint64_t> _totalBoards;
+            std::vector<uint64_t> _playerBoards;
+
+        public:
+            BoardBatch() = default;
+            explicit BoardBatch(const std::vector<Board>& boards);
+
+            inline size_t size() const {return _totalBoards.size();}
+            inline bool empty() const {return _totalBoards.empty();}
+
+            inline void reserve(size_t size) {
+                _totalBoards.reserve(size);
+                _playerBoards.reserve(size);
+            }
+
+            inline void clear() {
+                _totalBoards.clear();
+                _playerBoards.clear();
+            }
+
+            inline void push(const Board& board) {
+                _totalBoards.push_back(board.getTotalBoard());
+                _playerBoards.push_back(board.getPlayerBoard());
+            }
+
+            // Each fills one result per board, in the order the boards were added
+            void getPlayerWins(bool* wins) const;
+            void getOpponentWins(bool* wins) const;
+            void getPlayerWinningCells(uint64_t* cells) const;
+            void getOpponentWinningCells(uint64_t* cells) const;
+            // Lowest empty cell of every column that is not full, so full columns have no bit
+            void getPossibleMoves(uint64_t* moves) const;
+
+            // Widest instruction set the CPU supports, unless setInstructionSet chose another
+            static InstructionSet getInstructionSet();
+            // Used by the benchmarks to compare kernels, returns false when the CPU lacks instructionSet
+            static bool setInstructionSet(InstructionSet instructionSet);
+            static const char* getInstructionSetName(InstructionSet instructionSet);
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <connect4/board.h>
+#include <utils/mapped_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace connect4 {
+    // Exact scores of positions with few empty cells, memory mapped like the opening book. Entries are
+    // grouped into buckets by a hash of their key, and an index of bucket offsets follows the header,
+    // so a probe reads one offset and scans a handful of entries instead of bisecting the whole file.
+    //
+    // A table holds every position reachable from the positions it has, i.e. whole endgame subtrees.
+    //
+    // Positions are keyed by Board::getCanonicalKey with the stones of the side to move as the player
+    // stones, and scores are from the point of view of the side to move.
+    class EndgameTable {
+        public:
+            struct Header {
+                char magic[4];
+                uint32_t version;
+                uint32_t maxEmptyCells;
+                uint32_t indexBits;
+                uint64_t numEntries;
+            };
+
+            static constexpr char MAGIC[4] = {'C', '4', 'E', 'G'};
+            static constexpr uint32_t VERSION = 1;
+
+        private:
+            // Entry layout: key (56 bits, only 49 used) | score (8 bits)
+            static constexpr uint64_t KEY_MASK = (1ULL << 56) - 1;
+            // Entries per bucket the writer aims for
+            static constexpr size_t BUCKET_ENTRIES = 4;
+            static constexpr uint32_t MAX_INDEX_BITS = 24;
+
+            utils::MappedFile _file;
+            // 2^indexBits + 1 offsets into _entries, bucket i holds entries [_index[i], _index[i + 1])
+            const uint32_t* _index = nullptr;
+            const uint64_t* _entries = nullptr;
+            size_t _numEntries = 0;
+            uint8_t _indexShift = 64;
+            uint8_t _maxEmptyCells = 0;
+
+            static inline size_t _getBucket(uint64_t key, uint8_t indexShift) {
+                return indexShift >= 64 ? 0 : static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> indexShift);
+            }
+
+            // The index is padded to a multiple of 8 bytes, so the entries after it stay aligned
+            static inline size_t _getIndexBytes(uint32_t indexBits) {
+                const size_t numOffsets = (size_t(1) << indexBits) + 1;
+                return (numOffsets * sizeof(uint32_t) + 7) & ~size_t(7);
+            }
+
+        public:
+            EndgameTable() = default;
+            EndgameTable(const EndgameTable&) = delete;
+            EndgameTable& operator=(const EndgameTable&) = delete;
+
+            bool load(const std::string& path);
+            void unload();
+
+            inline bool isLoaded() const {return _entries != nullptr;}
+            inline uint8_t getMaxEmptyCells() const {return _maxEmptyCells;}
+            // Plies from which positions may be in the table, above 42 when none are loaded
+            inline uint8_t getMinPly() const {return isLoaded() ? 42 - _maxEmptyCells : 43;}
+            inline size_t getNumEntries() const {return _numEntries;}
+
+            bool probe(const Board& board, int8_t& score) const;
+
+            // entries hold (canonical key, score) pairs in any order
+            static bool write(const std::string& path, uint8_t maxEmptyCells, std::vector<std::pair<uint64_t, int8_t>> entries);
+    };
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <connect4/endgame_table.h>
+#include <connect4/opening_book.h>
+#include <utils/work_stealing_pool.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+
+namespace connect4 {
+    // Runs the moves of many hosted players on one fixed pool of threads. A hosted player (constructed
+    // with Player(EngineHost&)) starts no threads of its own: each of its moves is a task on the host's
+    // pool, searched on a single thread against that player's own deadline. Tasks run in the order the
+    // moves were requested, so no game waits behind moves requested after its own.
+    //
+    // The opening book and endgame table are shared read-only by every hosted player that has not loaded its own.
+    // Every hosted player must be destroyed before its host.
+    class EngineHost {
+        friend class Player;
+
+        public:
+            // Memo size of each hosted player, far below a standalone player's to allow thousands of games
+            static constexpr size_t DEFAULT_SESSION_MEMO_BYTES = 1024 * 1024;
+
+        private:
+            OpeningBook _openingBook;
+            EndgameTable _endgameTable;
+            size_t _sessionMemoBytes = DEFAULT_SESSION_MEMO_BYTES;
+            utils::WorkStealingPool _pool;
+
+            inline void _submit(std::function<void()> task) {_pool.submit(std::move(task));}
+
+        public:
+            // numThreads of 0 uses one thread per hardware thread
+            explicit EngineHost(size_t numThreads = 0);
+            EngineHost(const EngineHost&) = delete;
+            EngineHost& operator=(const EngineHost&) = delete;
+
+            inline size_t getNumThreads() const {return _pool.getNumThreads();}
+
+            // Applies to players constructed afterwards
+            inline void setSessionMemoBudgetBytes(size_t bytes) {_sessionMemoBytes = bytes;}
+            inline size_t getSessionMemoBudgetBytes() const {return _sessionMemoBytes;}
+
+            // Must be loaded before any hosted player starts a game
+            bool loadOpeningBook(const std::string& path);
+            inline const OpeningBook& getOpeningBook() const {return _openingBook;}
+            bool loadEndgameTable(const std::string& path);
+            inline const EndgameTable& getEndgameTable() const {return _endgameTable;}
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <connect4/board.h>
+#include <utils/bits.h>
+
+#include <cstdint>
+
+
+namespace connect4 {
+    // Static evaluations of the positions left unresolved at the search horizon, chosen per difficulty.
+    // Boards have the stones of the side to move as the player stones, and a higher score is better for it.
+    enum Evaluation : uint8_t {
+        // Every unresolved position scores as a draw
+        EVALUATION_NONE = 0,
+        // Stones in the central columns, which take part in the most alignments
+        EVALUATION_CENTER = 1,
+        // Central stones, and the cells each side would complete four on, weighted by row parity
+        EVALUATION_THREATS = 2
+    };
+
+    // Rows of the bottom-up row numbers 1, 3, 5 and 2, 4, 6. When the board fills up, the first player can
+    // usually claim a threat on an odd row and the second player one on an even row.
+    static constexpr uint64_t ODD_ROWS = Board::BOTTOM_MASK * 0x15;
+    static constexpr uint64_t EVEN_ROWS = Board::BOTTOM_MASK * 0x2A;
+
+    inline int evaluateCenter(const Board& board) {
+        constexpr uint64_t CENTER = Board::columnMask(3);
+        constexpr uint64_t NEAR_CENTER = Board::columnMask(2) | Board::columnMask(4);
+
+        const uint64_t own = board.getPlayerBoard();
+        const uint64_t other = board.getOpponentBoard();
+        return 2 * (utils::popCount(own & CENTER) - utils::popCount(other & CENTER))
+            + utils::popCount(own & NEAR_CENTER) - utils::popCount(other & NEAR_CENTER);
+    }
+
+    inline int evaluateThreats(const Board& board) {
+        const uint64_t total = board.getTotalBoard();
+        const uint64_t ownThreats = Board::getWinningCells(board.getPlayerBoard(), total);
+        const uint64_t otherThreats = Board::getWinningCells(board.getOpponentBoard(), total);
+
+        // The side to move is the first player on an even number of stones
+        const uint64_t ownRows = (utils::popCount(total) & 1) == 0 ? ODD_ROWS : EVEN_ROWS;
+        const uint64_t otherRows = Board::BOARD_MASK ^ ownRows;
+
+        int score = evaluateCenter(board);
+        score += 2 * (utils::popCount(ownThreats) + utils::popCount(ownThreats & ownRows));
+        score -= 2 * (utils::popCount(otherThreats) + utils::popCount(otherThreats & otherRows));
+
+        // A threat the other side could fill right away has to be blocked with the next stone
+        score -= 2 * utils::popCount(otherThreats & board.getPossibleMoves());
+        return score;
+    }
+
+    inline int evaluate(Evaluation evaluation, const Board& board) {
+        switch (evaluation) {
+            case EVALUATION_CENTER:
+                return evaluateCenter(board);
+            case EVALUATION_THREATS:
+                return evaluateThreats(board);
+            default:
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <connect4/board.h>
+#include <utils/mapped_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace connect4 {
+    // Exact scores of early positions, stored as a sorted array of 64-bit entries and memory mapped,
+    // so loading costs nothing and lookups read the file in place.
+    //
+    // Positions are keyed by Board::getCanonicalKey with the stones of the side to move as the player
+    // stones, and scores are from the point of view of the side to move.
+    class OpeningBook {
+        public:
+            struct Header {
+                char magic[4];
+                uint32_t version;
+                uint32_t maxPly;
+                uint32_t reserved;
+                uint64_t numEntries;
+            };
+
+            static constexpr char MAGIC[4] = {'C', '4', 'O', 'B'};
+            static constexpr uint32_t VERSION = 1;
+
+        private:
+            // Entry layout: key (56 bits, only 49 used) | score (8 bits)
+            static constexpr uint64_t KEY_MASK = (1ULL << 56) - 1;
+
+            utils::MappedFile _file;
+            const uint64_t* _entries = nullptr;
+            size_t _numEntries = 0;
+            uint8_t _maxPly = 0;
+
+        public:
+            OpeningBook() = default;
+            OpeningBook(const OpeningBook&) = delete;
+            OpeningBook& operator=(const OpeningBook&) = delete;
+
+            bool load(const std::string& path);
+            void unload();
+
+            inline bool isLoaded() const {return _entries != nullptr;}
+            inline uint8_t getMaxPly() const {return _maxPly;}
+            inline size_t getNumEntries() const {return _numEntries;}
+
+            bool probe(const Board& board, int8_t& score) const;
+
+            // entries hold (canonical key, score) pairs in any order
+            static bool write(const std::string& path, uint8_t maxPly, std::vector<std::pair<uint64_t, int8_t>> entries);
+    };
+}
@@ -1,38 +1,45 @@
 #pragma once
 
 #include <connect4/board.h>
+#include <connect4/endgame_table.h>
+#include <connect4/evaluation.h>
+#include <connect4/opening_book.h>
+#include <connect4/position.h>
+#include <connect4/search_stats.h>
+#include <connect4/transposition_table.h>
 #include <utils/atomic_flag.h>
+#include <utils/bits.h>
+#include <utils/thread_pool.h>
 
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <memory>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
 #include <random>
+#include <string>
+#include <vector>
 
 #define MIN_SCORE -42
 #define MAX_SCORE 42
 
+// Depth of the fallback search run before solving in DIFFICULTY_PERFECT
+#define PERFECT_FALLBACK_DEPTH 8
 
-namespace connect4 {
-    class Player {
-        enum SearchFlag : uint8_t {
-            NOT_SET = 0,
-            EXACT = 1,
-            LOWERBOUND = 2,
-            UPPERBOUND = 3
-        };
+// Depth of the search predicting the opponent's reply when the memo holds no best move
+#define PONDER_PREDICTION_DEPTH 6
 
-        struct SearchResult {
-            int8_t score = 0;
-            SearchFlag flag = NOT_SET;
-        };
 
-        using BoardMap = std::unordered_map<Board, SearchResult, BoardHash>;
-        using ScoreArray = std::array<int8_t, 7>;
+namespace connect4 {
+    class EngineHost;
 
+    class Player {
         public:
+            // Score of every column with the player to move, MIN_SCORE for full columns
+            using ScoreArray = std::array<int8_t, 7>;
+
             enum Turn : uint8_t {
                 PLAYER = 0,
                 OPPONENT = 1
@@ -47,7 +54,9 @@ namespace connect4 {
                 DIFFICULTY_5 = 5,
                 DIFFICULTY_6 = 6,
                 DIFFICULTY_7 = 7,
-                DIFFICULTY_8 = 8
+                DIFFICULTY_8 = 8,
+                // Solves every root move exactly, falling back to a shallow search on time-out
+                DIFFICULTY_PERFECT = 9
             };
 
             enum Winner : uint8_t {
@@ -58,6 +67,94 @@ namespace connect4 {
             };
 
         private:
+            // State of one search. Searches of different positions each have their own, so they can run
+            // at the same time while sharing the memo and history.
+            struct SearchContext {
+                // Stones on the board the search started from
+                uint8_t rootPly;
+                uint8_t maxDepth;
+                // Steady clock nanoseconds, or the searching thread's node count when isNodeClock is set
+                int64_t deadline;
+                utils::AtomicFlag& isTimeOut;
+                Evaluation evaluation;
+                // Exact scores of late positions, null when the search does not use one
+                const EndgameTable* endgameTable;
+                // Deterministic searches are bounded by the nodes searched, which every run counts the same
+                bool isNodeClock = false;
+
+                inline int8_t getScore(uint8_t depth) const {
+                    return MAX_SCORE - static_cast<int8_t>(rootPly + depth);
+                }
+
+                // Largest evaluation of a search with its horizon at horizonDepth. Every win or loss the search
+                // finds itself comes before the third stone after the horizon, so it scores higher.
+                inline int8_t getEvaluationLimit(uint8_t horizonDepth) const {
+                    const int8_t limit = getScore(horizonDepth + 3) - 1;
+                    return evaluation == EVALUATION_NONE || limit < 0 ? 0 : limit;
+                }
+
+                // Evaluation of a position left unresolved at the horizon (side to move as the player stones)
+                inline int8_t getHorizonScore(const Board& board) const {
+                    const int limit = getEvaluationLimit(maxDepth);
+                    return static_cast<int8_t>(std::clamp(evaluate(evaluation, board), -limit, limit));
+                }
+
+                // Score found outside this search, i.e. a memo entry of a deeper search or an exact score, where
+                // wins and losses score above scoreLimit. Those may still be within this search's evaluation
+                // range, so they are raised just above it: no evaluation may outrank a proven win or loss.
+                inline int8_t getProvenScore(int8_t score, int8_t scoreLimit) const {
+                    const int8_t limit = getEvaluationLimit(maxDepth);
+                    if (score > scoreLimit) {
+                        return std::max<int8_t>(score, limit + 1);
+                    }
+                    if (score < -scoreLimit) {
+                        return std::min<int8_t>(score, -limit - 1);
+                    }
+                    return score;
+                }
+
+                // Whether a memo entry reaching remainingDepth holds a score of this search: solved scores hold in
+                // any search, the others only in searches with the same evaluation
+                inline bool isUsable(const SearchResult& entry, uint8_t remainingDepth) const {
+                    return entry.depth >= remainingDepth && (entry.depth == TranspositionTable::DEPTH_SOLVED || entry.evaluation == evaluation);
+                }
+
+                // Whether the path to a node at depth first reaches the plies of the endgame table there. The table
+                // holds every position reachable from those it has, so the nodes below a miss are not probed.
+                inline bool isEndgameTableEntry(uint8_t depth) const {
+                    if (!endgameTable) {
+                        return false;
+                    }
+                    const uint8_t ply = rootPly + depth;
+                    const uint8_t minPly = endgameTable->getMinPly();
+                    return ply == minPly || (ply > minPly && depth <= 1);
+                }
+
+                // Depth left below a node, or DEPTH_SOLVED when the horizon lies beyond the end of the game
+                inline uint8_t getRemainingDepth(uint8_t depth) const {
+                    uint8_t remainingDepth = maxDepth - depth;
+                    uint8_t emptyCells = 42 - (rootPly + depth);
+                    return remainingDepth >= emptyCells ? TranspositionTable::DEPTH_SOLVED : remainingDepth;
+                }
+
+                inline void checkDeadline(uint64_t nodeCount) const {
+                    const int64_t now = isNodeClock ? static_cast<int64_t>(nodeCount) : _now();
+                    if (now >= deadline) {
+                        isTimeOut = true;
+                    }
+                }
+            };
+
+            // Counters of the calling thread, taken when a root task starts and added to the player's totals when it ends
+            struct ThreadCounters {
+                uint64_t nodes;
+#if CONNECT4_SEARCH_STATS
+                uint64_t cutoffs;
+                uint64_t firstMoveCutoffs;
+                TranspositionTable::Counters memo;
+#endif
+            };
+
             // Game state
             Board _board;
             uint8_t _turnCount = 0;
@@ -67,29 +164,72 @@ namespace connect4 {
             // Difficulty parameters
             uint32_t _maxThinkingTime = 5000;
             uint8_t _globalMaxDepth = 8;
+            Evaluation _evaluation = EVALUATION_NONE;
             bool _allowIdleSearch = true;
+            bool _useOpeningBook = false;
+            bool _useEndgameTable = false;
 
             // Player Info
-            std::atomic<uint32_t> _thinkingTimeMS{0};
+            std::atomic<int64_t> _thinkingTimeNS{0};
+            utils::AtomicFlag _isThinking{false};
             utils::AtomicFlag _isPlaying{false};
             Difficulty _playerDifficulty = DIFFICULTY_0;
 
+            // Host running the moves of a hosted player, null for a player with its own threads
+            EngineHost* _host = nullptr;
+
+            // Moves scheduled on the host and not finished yet
+            std::mutex _hostedTurnMutex;
+            std::condition_variable _hostedTurnCV;
+            uint32_t _numHostedTurns = 0;
+
             // Search variables
-            BoardMap _memo;
-            uint8_t _maxDepth = 4;
+            OpeningBook _openingBook;
+            EndgameTable _endgameTable;
+            TranspositionTable _memo;
+
+            // Cutoffs caused by each move (side and cell), used to order moves
+            std::array<std::atomic<uint32_t>, 2 * 64> _history{};
+            std::atomic<uint64_t> _nodeCount{0};
+#if CONNECT4_SEARCH_STATS
+            std::atomic<uint64_t> _cutoffCount{0};
+            std::atomic<uint64_t> _firstMoveCutoffCount{0};
+
+            // Statistics of the last move's search other than the counters, written between iterations
+            mutable std::mutex _statsMutex;
+            SearchStats _searchStats;
+            TranspositionTable::Stats _memoStatsAtStart;
+            int64_t _iterationStartTime = 0;
+            uint64_t _iterationStartNodes = 0;
+#endif
+
+            // Search threads, including the game thread
+            uint8_t _numSearchThreads = 1;
+            std::unique_ptr<utils::ThreadPool> _searchPool;
 
             // Game Thread
             std::thread _gameThread;
+            std::mutex _gameMutex;
             mutable std::condition_variable _gameCV;
+
+            // Opponent move queued by applyOpponentMove for the thread playing the player's turn, which applies it.
+            // The slot stays taken until that turn ends, so only one move can be queued per turn.
+            static constexpr uint8_t NO_QUEUED_MOVE = 0xFF;
+            std::atomic<uint8_t> _queuedOpponentMove{NO_QUEUED_MOVE};
             
-            // Timer Thread
-            mutable std::condition_variable _timerCV;
-            mutable std::mutex _timerMutex;
-            std::thread _timerThread;
+            // Start of the current move's search, steady clock nanoseconds
+            std::atomic<int64_t> _searchStartTime{0};
             utils::AtomicFlag _isTimeOut{false};
-            utils::AtomicFlag _runTimer{false};
 
-            // Idle Search Thread
+            // Scores of a position after a predicted opponent reply, found while pondering
+            struct PonderResult {
+                Board board;
+                ScoreArray scores;
+            };
+
+            // Idle Search Thread, pondering on the opponent's replies. Results are guarded by _idleSearchMutex.
+            std::vector<PonderResult> _ponderResults;
+            utils::AtomicFlag _stopPonder{false};
             mutable std::condition_variable _idleSearchCV;
             mutable std::mutex _idleSearchMutex;
             std::thread _idleSearchThread;
@@ -98,29 +238,72 @@ namespace connect4 {
 
             // Thread control
             utils::AtomicFlag _endThreads{false};
-            mutable std::mutex _memoMutex;
             
             // Misc
             std::mt19937 _rng{std::random_device{}()};
+
+            // Deterministic mode, see setDeterministic
+            bool _isDeterministic = false;
+            uint32_t _seed = 0;
+            uint64_t _maxNodes = 0;
             
 
-            inline uint32_t _updateThinkingTimeMS(std::chrono::steady_clock::time_point startTime) {
-                uint32_t thinkingTimeMS = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
-                _thinkingTimeMS.store(thinkingTimeMS, std::memory_order_release);
-                return thinkingTimeMS;
+            static inline int64_t _now() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            // Search context of the game's current position
+            inline SearchContext _getGameContext(uint8_t maxDepth, int64_t deadline = INT64_MAX) {
+                return SearchContext{_turnCount, maxDepth, deadline, _isTimeOut, _evaluation, _getGameEndgameTable(), _isDeterministic};
+            }
+
+            // Endgame table of the game's searches, null when the difficulty does not use one
+            inline const EndgameTable* _getGameEndgameTable() const {
+                return _useEndgameTable ? &_getEndgameTable() : nullptr;
             }
 
-            inline int8_t _getScore(uint8_t depth) const {
-                return MAX_SCORE - static_cast<int8_t>(_turnCount + depth);
+            static inline uint8_t _getHistoryIndex(Turn side, uint64_t move) {
+                return static_cast<uint8_t>(side * 64 + utils::countTrailingZeros(move));
             }
 
-            void _timerThreadFunc();
+            // Returns the deadline of the move
+            int64_t _startSearchClock();
+            void _stopSearchClock();
+            int64_t _getThinkingTimeNS() const;
+
+            static ThreadCounters _getThreadCounters();
+            void _addThreadCounters(const ThreadCounters& start);
+            void _resetCounters();
+            void _beginSearchStats();
+            void _recordIteration(uint8_t depth);
+            void _endSearchStats(uint8_t col);
             void _idleSearchThreadFunc();
+            void _ponder();
+            uint8_t _getLikelyReplies(uint8_t* replies);
+            bool _getPonderScores(ScoreArray& scores) const;
             void _play();
+            void _notifyGameThread();
+            void _applyQueuedOpponentMove();
+            bool _takeTurn();
+            void _scheduleHostedTurn();
+            void _waitForHostedTurns();
 
-            int8_t _negamaxPlayer(const Board& board, uint8_t depth, int8_t alpha, int8_t beta);
-            int8_t _negamaxOpponent(const Board& board, uint8_t depth, int8_t alpha, int8_t beta);
+            template <Turn side>
+            int8_t _negamax(const SearchContext& context, Position& position, int8_t alpha, int8_t beta);
+            template <Turn side>
+            int8_t _solve(const SearchContext& context, Position& position);
+            uint8_t _orderMoves(const Board& board, Turn side, uint64_t candidates, uint8_t bestMove, uint8_t* moves) const;
+            void _updateHistory(const Board& board, Turn side, uint8_t col, uint8_t remainingDepth);
             void _getScores(ScoreArray& scores);
+            int8_t _searchColumn(const SearchContext& context, const Board& board, uint8_t col);
+            void _searchRootColumn(const SearchContext& context, const Board& root, ScoreArray& scores, uint8_t col);
+            void _searchScores(SearchContext& context, const Board& root, ScoreArray& scores);
+            void _solveScores(SearchContext& context, const Board& root, ScoreArray& scores);
+            void _analyzeBoard(const Board& board, uint8_t maxDepth, uint32_t maxTimeMS, ScoreArray& scores);
+            bool _getBookScores(ScoreArray& scores) const;
+            bool _getEndgameScores(ScoreArray& scores) const;
+            const OpeningBook& _getOpeningBook() const;
+            const EndgameTable& _getEndgameTable() const;
 
             void _reset(bool hardReset = false);
             void _applyDifficultySettings();
@@ -128,13 +311,21 @@ namespace connect4 {
             void _applyPlayerMove();
         public:
             Player();
+            // Hosted player, see EngineHost
+            explicit Player(EngineHost& host);
             ~Player();
 
             inline Board getBoard() const {return _board;}
 
             inline uint8_t getMaxDepth() const {return _globalMaxDepth;}
             inline uint8_t getTurnCount() const {return _turnCount;}
-            inline uint32_t getThinkingTimeMS() const {return _thinkingTimeMS.load(std::memory_order_acquire);}
+            // Time spent on the current move while thinking, else on the last move
+            uint32_t getThinkingTimeMS() const;
+            // Nodes searched to choose the last move, or by the last solve or analyze call
+            inline uint64_t getNodeCount() const {return _nodeCount.load(std::memory_order_acquire);}
+            // Statistics of the current move's search while thinking, else of the last move's. Counters other than
+            // time also cover the last solve or analyze call. Only nodes and time are kept without CONNECT4_SEARCH_STATS.
+            SearchStats getSearchStats() const;
             inline bool isPlaying() const {return _isPlaying;}
             inline Turn getCurrentTurn() const {return _isPlayerTurn ? PLAYER : OPPONENT;}
             inline bool isIdleSearching() const {return _isIdleSearching;}
@@ -142,7 +333,54 @@ namespace connect4 {
             inline Winner getWinner() const {return _winner.load(std::memory_order_acquire);}
             void setDifficulty(Difficulty difficulty);
             size_t getMemoSize() const;
+
+            // Root columns are searched in parallel on up to 7 threads, applied while no game is being played.
+            // Hosted players always search on a single thread.
+            void setSearchThreads(uint8_t numThreads);
+            inline uint8_t getSearchThreads() const {return _numSearchThreads;}
+
+            // Deterministic mode for regression tests and benchmark games, applied while no game is being played: the same
+            // games give the same moves and node counts on every run. Each game starts from an empty memo and history and
+            // breaks ties between the best moves with an RNG seeded with seed. Moves are searched on a single thread without
+            // pondering, and the thinking time is replaced by a budget of maxNodes nodes per move (0 for the difficulty's
+            // full depth, however long it takes).
+            void setDeterministic(bool isDeterministic, uint32_t seed = 0, uint64_t maxNodes = 0);
+            inline bool isDeterministic() const {return _isDeterministic;}
+
+            // Memory used by the search memo, applied while no game is being played
+            void setMemoBudgetBytes(size_t bytes);
+            inline size_t getMemoBudgetBytes() const {return _memo.getSizeBytes();}
+            inline TranspositionTable::Stats getMemoStats() const {return _memo.getStats();}
+
+            // Solved memo entries survive start(). A snapshot of them can be saved at any time and loaded while
+            // no game is being played, e.g. to warm up a new process (resizing the memo drops them again).
+            bool saveMemoSnapshot(const std::string& path) const;
+            bool loadMemoSnapshot(const std::string& path);
             
+            // Opening book consulted before searching at DIFFICULTY_6 and above, applied while no game is being played.
+            // A hosted player without its own book uses the host's.
+            bool loadOpeningBook(const std::string& path);
+            bool hasOpeningBook() const;
+
+            // Endgame table probed by the search once few cells are left empty, at DIFFICULTY_6 and above and by
+            // solve and analyze. Applied while no game is being played; a hosted player without its own uses the host's.
+            bool loadEndgameTable(const std::string& path);
+            bool hasEndgameTable() const;
+
+            // Exact score of a position with the player to move, blocking until it is solved.
+            // Used by offline tools; returns 0 without searching while a game is being played.
+            int8_t solve(const Board& board);
+
+            // Scores of every column of each board (player to move) from an iterative deepening search up to
+            // maxDepth, stopped after maxTimeMS per board when it is not 0, keeping the deepest completed pass.
+            // Positions unresolved at maxDepth are scored with EVALUATION_THREATS.
+            // Boards are searched in parallel on numThreads threads (0 for one per hardware thread), without the
+            // game threads, and share the memo with each other and with the game. Safe to call from several
+            // threads at once, but not together with setMemoBudgetBytes.
+            std::vector<ScoreArray> analyze(const std::vector<Board>& boards, uint8_t maxDepth, uint32_t maxTimeMS = 0, size_t numThreads = 0);
+
+            // Queues the opponent's move and returns without waiting for the game threads. The player's turn starts
+            // at once, while the board and turn count show the move once the pondering has stopped and it is applied.
             bool applyOpponentMove(uint8_t col);
 
             void start(bool playerMovesFirst = false);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <connect4/board.h>
+
+#include <cstdint>
+
+
+namespace connect4 {
+    // Boards of a running search, one per ply on a contiguous stack: play builds the child on top of
+    // the current board and undo pops it, so a node's children reuse the same few cache lines
+    class Position {
+        private:
+            // _boards[0] is the board the position was built from, _boards[_numMoves] the current one
+            Board _boards[Board::WIDTH * Board::HEIGHT + 1];
+            uint8_t _numMoves = 0;
+
+        public:
+            explicit Position(const Board& board) {_boards[0] = board;}
+            Position(const Position&) = delete;
+            Position& operator=(const Position&) = delete;
+
+            // Stays unchanged while children are played and undone
+            inline const Board& getBoard() const {return _boards[_numMoves];}
+
+            // Moves played since the position was built, i.e. the depth below the search root
+            inline uint8_t getNumMoves() const {return _numMoves;}
+
+            inline void playPlayer(uint8_t col) {
+                _boards[_numMoves + 1] = _boards[_numMoves];
+                _boards[++_numMoves].placePlayer(col);
+            }
+
+            inline void playOpponent(uint8_t col) {
+                _boards[_numMoves + 1] = _boards[_numMoves];
+                _boards[++_numMoves].placeOpponent(col);
+            }
+
+            inline void undo() {--_numMoves;}
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Search statistics are gathered unless built with CONNECT4_SEARCH_STATS=0, which removes every counter
+// from the search and the transposition table
+#ifndef CONNECT4_SEARCH_STATS
+#define CONNECT4_SEARCH_STATS 1
+#endif
+
+
+namespace connect4 {
+    // Snapshot of the statistics of a player's last (or current) move search
+    struct SearchStats {
+        struct Iteration {
+            uint8_t depth = 0;
+            // Nodes and time of this iteration alone
+            uint64_t nodes = 0;
+            uint32_t timeUS = 0;
+        };
+
+        uint64_t nodes = 0;
+        uint32_t timeMS = 0;
+        double nodesPerSecond = 0.0;
+
+        // Deepest iteration completed before the search finished or timed out, 0 when none did
+        uint8_t completedDepth = 0;
+        std::vector<Iteration> iterations;
+
+        // Nodes failing high, and how many of them did so on the first move searched
+        uint64_t cutoffs = 0;
+        uint64_t firstMoveCutoffs = 0;
+
+        // Memo activity during the search, evictions overwrote a live entry of another position
+        // and collisions missed on a bucket filled with other positions
+        uint64_t memoProbes = 0;
+        uint64_t memoHits = 0;
+        uint64_t memoStores = 0;
+        uint64_t memoEvictions = 0;
+        uint64_t memoCollisions = 0;
+
+        // Chosen move followed by the best replies the memo holds
+        std::vector<uint8_t> principalVariation;
+
+        inline double getFirstMoveCutoffRate() const {return cutoffs == 0 ? 0.0 : static_cast<double>(firstMoveCutoffs) / static_cast<double>(cutoffs);}
+        inline double getMemoHitRate() const {return memoProbes == 0 ? 0.0 : static_cast<double>(memoHits) / static_cast<double>(memoProbes);}
+    };
+}
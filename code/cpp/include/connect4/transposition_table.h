@@ -0,0 +1,170 @@
+#pragma once
+
+#include <connect4/evaluation.h>
+#include <connect4/search_stats.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+
+namespace connect4 {
+    enum SearchFlag : uint8_t {
+        NOT_SET = 0,
+        EXACT = 1,
+        LOWERBOUND = 2,
+        UPPERBOUND = 3
+    };
+
+    struct SearchResult {
+        static constexpr uint8_t NO_MOVE = 7;
+
+        int8_t score = 0;
+        SearchFlag flag = NOT_SET;
+        // Remaining search depth the score was computed with
+        uint8_t depth = 0;
+        // Column of the best (or refuting) move found
+        uint8_t bestMove = NO_MOVE;
+        // Evaluation of the horizon positions below the node, only meaningful when depth is not DEPTH_SOLVED
+        Evaluation evaluation = EVALUATION_NONE;
+    };
+
+    // Fixed-size transposition table shared by every search thread without locking.
+    // Each slot keeps the key XOR-ed with its data word next to the data word itself, so a probe
+    // that races with a store sees a key mismatch and is treated as a miss instead of a torn entry.
+    class TranspositionTable {
+        private:
+            struct Slot {
+                std::atomic<uint64_t> check{0};
+                std::atomic<uint64_t> data{0};
+            };
+
+            static constexpr size_t SLOTS_PER_BUCKET = 4;
+
+            // One bucket per cache line, probes never touch more than one line
+            struct alignas(64) Bucket {
+                Slot slots[SLOTS_PER_BUCKET];
+            };
+
+            std::unique_ptr<Bucket[]> _buckets;
+            size_t _bucketMask = 0;
+
+            // Positions with fewer stones than the current game position can no longer be reached
+            std::atomic<uint8_t> _rootPly{0};
+
+            // Slots holding an entry, each counted once by the store that claimed it while empty
+            std::atomic<size_t> _used{0};
+            // Totals of the counters added by the search threads, only counted when CONNECT4_SEARCH_STATS is enabled
+            std::atomic<uint64_t> _probes{0};
+            std::atomic<uint64_t> _hits{0};
+            std::atomic<uint64_t> _stores{0};
+            std::atomic<uint64_t> _evictions{0};
+            std::atomic<uint64_t> _collisions{0};
+
+            // Data word layout: score (8 bits) | flag (2 bits) | depth (6 bits) | ply (6 bits) | best move (3 bits) | evaluation (2 bits)
+            static inline uint64_t _pack(const SearchResult& result, uint8_t ply) {
+                return static_cast<uint64_t>(static_cast<uint8_t>(result.score))
+                    | (static_cast<uint64_t>(result.flag) << 8)
+                    | (static_cast<uint64_t>(result.depth & 0x3F) << 10)
+                    | (static_cast<uint64_t>(ply & 0x3F) << 16)
+                    | (static_cast<uint64_t>(result.bestMove & 0x7) << 22)
+                    | (static_cast<uint64_t>(result.evaluation & 0x3) << 25);
+            }
+
+            static inline uint8_t _unpackPly(uint64_t data) {
+                return static_cast<uint8_t>((data >> 16) & 0x3F);
+            }
+
+            static inline SearchResult _unpack(uint64_t data) {
+                SearchResult result;
+                result.score = static_cast<int8_t>(data & 0xFF);
+                result.flag = static_cast<SearchFlag>((data >> 8) & 0x3);
+                result.depth = static_cast<uint8_t>((data >> 10) & 0x3F);
+                result.bestMove = static_cast<uint8_t>((data >> 22) & 0x7);
+                result.evaluation = static_cast<Evaluation>((data >> 25) & 0x3);
+                return result;
+            }
+
+            // Snapshot entry layout: key (49 bits) | ply (7 bits) | score (8 bits)
+            static constexpr uint64_t SNAPSHOT_KEY_MASK = (1ULL << 49) - 1;
+
+            inline Bucket& _getBucket(uint64_t key) const;
+            void _resetStats();
+
+        public:
+            // Probes and stores of one thread, counted without touching shared memory and added to
+            // a table's totals once per search task, like the player's node counts
+            struct Counters {
+                uint64_t probes = 0;
+                uint64_t hits = 0;
+                uint64_t stores = 0;
+                uint64_t evictions = 0;
+                uint64_t collisions = 0;
+            };
+
+            struct Stats {
+                size_t sizeBytes = 0;
+                size_t capacity = 0;
+                size_t used = 0;
+                uint64_t probes = 0;
+                uint64_t hits = 0;
+                uint64_t stores = 0;
+                // Live entries overwritten by a different position
+                uint64_t evictions = 0;
+                // Misses on a bucket whose every slot holds another position
+                uint64_t collisions = 0;
+
+                inline double getHitRate() const {return probes == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(probes);}
+            };
+
+            struct SnapshotHeader {
+                char magic[4];
+                uint32_t version;
+                uint64_t numEntries;
+            };
+
+            static constexpr char SNAPSHOT_MAGIC[4] = {'C', '4', 'T', 'T'};
+            static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+            static constexpr size_t DEFAULT_SIZE_BYTES = 16 * 1024 * 1024;
+
+            // Depth stored for results that did not depend on the search horizon
+            static constexpr uint8_t DEPTH_SOLVED = 63;
+
+            explicit TranspositionTable(size_t sizeBytes = DEFAULT_SIZE_BYTES);
+            TranspositionTable(const TranspositionTable&) = delete;
+            TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+            // Not thread safe, no search may use the table while it is resized or cleared
+            void resize(size_t sizeBytes);
+            void clear();
+            // Keeps only the entries that did not depend on the search horizon
+            void clearUnsolved();
+
+            bool probe(uint64_t key, SearchResult& result) const;
+            // ply is the number of stones on the stored position
+            void store(uint64_t key, uint8_t ply, const SearchResult& result);
+
+            // Called after every move, entries of earlier plies become free to replace
+            inline void setRootPly(uint8_t ply) {_rootPly.store(ply, std::memory_order_relaxed);}
+
+            Stats getStats() const;
+
+            // Counters of the calling thread over every table, zero without CONNECT4_SEARCH_STATS
+            static Counters getThreadCounters();
+            // Adds the calling thread's counters since start to the totals of this table
+            void addThreadCounters(const Counters& start);
+
+            // Writes every solved exact score to a file. Scores only depend on the position (wins are scored by
+            // the number of stones on the board), so a snapshot stays valid for any game reaching its positions.
+            bool saveSnapshot(const std::string& path) const;
+            // Stores the entries of a snapshot file, read in place through a memory mapping
+            bool loadSnapshot(const std::string& path);
+
+            inline size_t getCapacity() const {return (_bucketMask + 1) * SLOTS_PER_BUCKET;}
+            inline size_t getSizeBytes() const {return (_bucketMask + 1) * sizeof(Bucket);}
+            inline size_t getUsed() const {return _used.load(std::memory_order_relaxed);}
+    };
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace utils {
+    inline uint8_t popCount(uint64_t value) {
+#if defined(_MSC_VER)
+        return static_cast<uint8_t>(__popcnt64(value));
+#else
+        return static_cast<uint8_t>(__builtin_popcountll(value));
+#endif
+    }
+
+    // Index of the lowest set bit, value must not be zero
+    inline uint8_t countTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<uint8_t>(index);
+#else
+        return static_cast<uint8_t>(__builtin_ctzll(value));
+#endif
+    }
+}
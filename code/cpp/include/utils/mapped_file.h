@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace utils {
+    // Read-only memory mapping of a whole file. The contents are paged in on first access and
+    // shared between every process mapping the same file.
+    class MappedFile {
+        private:
+            const uint8_t* _data = nullptr;
+            size_t _size = 0;
+#if defined(_WIN32)
+            void* _fileHandle = nullptr;
+            void* _mappingHandle = nullptr;
+#endif
+
+        public:
+            MappedFile() = default;
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+            ~MappedFile();
+
+            bool open(const std::string& path);
+            void close();
+
+            inline bool isOpen() const {return _data != nullptr;}
+            inline const uint8_t* getData() const {return _data;}
+            inline size_t getSize() const {return _size;}
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace utils {
+    // Fixed set of worker threads running fork-join loops. The calling thread takes part in
+    // every loop, so a pool of N threads runs loops on N + 1 threads.
+    class ThreadPool {
+        private:
+            std::vector<std::thread> _threads;
+            std::mutex _mutex;
+            std::condition_variable _workCV;
+            std::condition_variable _doneCV;
+
+            const std::function<void(size_t)>* _task = nullptr;
+            size_t _taskCount = 0;
+            std::atomic<size_t> _nextIndex{0};
+            uint64_t _generation = 0;
+            size_t _activeWorkers = 0;
+            bool _stop = false;
+
+            inline void _runTasks() {
+                size_t index;
+                while ((index = _nextIndex.fetch_add(1, std::memory_order_relaxed)) < _taskCount) {
+                    (*_task)(index);
+                }
+            }
+
+            void _workerFunc() {
+                uint64_t seenGeneration = 0;
+                std::unique_lock<std::mutex> lock(_mutex);
+
+                while (true) {
+                    _workCV.wait(lock, [&]() {return _stop || _generation != seenGeneration;});
+                    if (_stop) return;
+                    seenGeneration = _generation;
+
+                    lock.unlock();
+                    _runTasks();
+                    lock.lock();
+
+                    if (--_activeWorkers == 0) {
+                        _doneCV.notify_one();
+                    }
+                }
+            }
+
+        public:
+            explicit ThreadPool(size_t numThreads) {
+                _threads.reserve(numThreads);
+                for (size_t i = 0; i < numThreads; ++i) {
+                    _threads.emplace_back(&ThreadPool::_workerFunc, this);
+                }
+            }
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            ~ThreadPool() {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _workCV.notify_all();
+
+                for (std::thread& thread : _threads) {
+                    if (thread.joinable()) thread.join();
+                }
+            }
+
+            // Number of threads running each loop, including the caller
+            inline size_t getNumThreads() const {return _threads.size() + 1;}
+
+            // Runs task(0) ... task(count - 1) across the pool and blocks until all have returned.
+            // Only one loop may run at a time.
+            void parallelFor(size_t count, const std::function<void(size_t)>& task) {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _task = &task;
+                    _taskCount = count;
+                    _nextIndex.store(0, std::memory_order_relaxed);
+                    _activeWorkers = _threads.size();
+                    ++_generation;
+                }
+                _workCV.notify_all();
+
+                _runTasks();
+
+                std::unique_lock<std::mutex> lock(_mutex);
+                _doneCV.wait(lock, [this]() {return _activeWorkers == 0;});
+                _task = nullptr;
+            }
+    };
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace utils {
+    // Fixed set of worker threads, each with its own task queue. Submitted tasks are spread over the
+    // queues round-robin, and a worker whose queue is empty takes tasks from the others. Queues are
+    // served oldest first, so tasks run roughly in submission order.
+    class WorkStealingPool {
+        private:
+            struct alignas(64) Queue {
+                std::mutex mutex;
+                std::deque<std::function<void()>> tasks;
+            };
+
+            std::vector<std::unique_ptr<Queue>> _queues;
+            std::vector<std::thread> _threads;
+            std::atomic<size_t> _nextQueue{0};
+
+            // Tasks in the queues, counted after they are pushed and when they are taken, so it may dip
+            // below zero for a moment. Submitting only touches _sleepMutex when a worker is parked.
+            std::atomic<int64_t> _numPending{0};
+            std::atomic<size_t> _numSleeping{0};
+            std::mutex _sleepMutex;
+            std::condition_variable _sleepCV;
+            bool _stop = false;
+
+            bool _popTask(size_t index, std::function<void()>& task) {
+                for (size_t i = 0; i < _queues.size(); ++i) {
+                    Queue& queue = *_queues[(index + i) % _queues.size()];
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    if (!queue.tasks.empty()) {
+                        task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                        _numPending.fetch_sub(1);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void _workerFunc(size_t index) {
+                while (true) {
+                    std::function<void()> task;
+                    if (_popTask(index, task)) {
+                        task();
+                        continue;
+                    }
+
+                    // Parked workers are counted before the pending tasks are checked, and submit counts its task
+                    // before checking for parked workers, so either this worker sees the task or it is woken
+                    std::unique_lock<std::mutex> lock(_sleepMutex);
+                    _numSleeping.fetch_add(1);
+                    _sleepCV.wait(lock, [this]() {return _stop || _numPending.load() > 0;});
+                    _numSleeping.fetch_sub(1);
+                    if (_stop && _numPending.load() <= 0) return;
+                }
+            }
+
+        public:
+            explicit WorkStealingPool(size_t numThreads) {
+                if (numThreads == 0) {
+                    numThreads = 1;
+                }
+
+                for (size_t i = 0; i < numThreads; ++i) {
+                    _queues.emplace_back(new Queue());
+                }
+
+                _threads.reserve(numThreads);
+                for (size_t i = 0; i < numThreads; ++i) {
+                    _threads.emplace_back(&WorkStealingPool::_workerFunc, this, i);
+                }
+            }
+
+            WorkStealingPool(const WorkStealingPool&) = delete;
+            WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+            // Runs every task already submitted before joining the workers
+            ~WorkStealingPool() {
+                {
+                    std::lock_guard<std::mutex> lock(_sleepMutex);
+                    _stop = true;
+                }
+                _sleepCV.notify_all();
+
+                for (std::thread& thread : _threads) {
+                    if (thread.joinable()) thread.join();
+                }
+            }
+
+            inline size_t getNumThreads() const {return _threads.size();}
+
+            void submit(std::function<void()> task) {
+                Queue& queue = *_queues[_nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size()];
+                {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    queue.tasks.push_back(std::move(task));
+                }
+
+                _numPending.fetch_add(1);
+                if (_numSleeping.load() > 0) {
+                    // Taking the mutex orders the notification after a parking worker's wait
+                    {
+                        std::lock_guard<std::mutex> lock(_sleepMutex);
+                    }
+                    _sleepCV.notify_one();
+                }
+            }
+    };
+}
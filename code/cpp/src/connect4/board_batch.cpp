@@ -0,0 +1,386 @@
+#include <connect4/board_batch.h>
+
+#include <atomic>
+
+// The vector kernels are compiled for their own instruction set whatever the build flags, and only
+// called once the CPU is known to support it
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CONNECT4_BATCH_X86 1
+#include <immintrin.h>
+#define CONNECT4_TARGET_AVX2 __attribute__((target("avx2")))
+#define CONNECT4_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CONNECT4_BATCH_X86 0
+#endif
+
+using namespace connect4;
+
+
+// Shifts between neighbouring cells of an alignment: vertical, horizontal and both diagonals
+static constexpr int VERTICAL = 1;
+static constexpr int HORIZONTAL = Board::COLUMN_BITS;
+static constexpr int DIAGONAL_DOWN = Board::COLUMN_BITS - 1;
+static constexpr int DIAGONAL_UP = Board::COLUMN_BITS + 1;
+
+
+template <bool ofOpponent>
+static inline uint64_t getStones(uint64_t total, uint64_t player) {
+    return ofOpponent ? total ^ player : player;
+}
+
+
+template <bool ofOpponent>
+static void getWinsScalar(const uint64_t* totals, const uint64_t* players, size_t size, bool* wins) {
+    for (size_t i = 0; i < size; ++i) {
+        wins[i] = Board::isWin(getStones<ofOpponent>(totals[i], players[i]));
+    }
+}
+
+
+template <bool ofOpponent>
+static void getWinningCellsScalar(const uint64_t* totals, const uint64_t* players, size_t size, uint64_t* cells) {
+    for (size_t i = 0; i < size; ++i) {
+        cells[i] = Board::getWinningCells(getStones<ofOpponent>(totals[i], players[i]), totals[i]);
+    }
+}
+
+
+static void getPossibleMovesScalar(const uint64_t* totals, size_t size, uint64_t* moves) {
+    for (size_t i = 0; i < size; ++i) {
+        moves[i] = (totals[i] + Board::BOTTOM_MASK) & Board::BOARD_MASK;
+    }
+}
+
+
+#if CONNECT4_BATCH_X86
+// Same steps as Board::isWin and Board::getWinningCells on 4 boards at once. The last vector of a batch
+// is loaded and stored through a lane mask, so batches of any size need no scalar tail.
+
+// Lanes holding a board, masked loads and stores use the top bit of each lane. Only the last vector
+// of a batch is masked, as masked moves are slower than plain ones.
+CONNECT4_TARGET_AVX2 static inline __m256i getLaneMaskAvx2(size_t remaining) {
+    if (remaining >= 4) {
+        return _mm256_set1_epi64x(-1);
+    }
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(remaining)), _mm256_set_epi64x(3, 2, 1, 0));
+}
+
+
+CONNECT4_TARGET_AVX2 static inline __m256i loadAvx2(const uint64_t* values, size_t remaining, __m256i mask) {
+    if (remaining >= 4) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+    }
+    return _mm256_maskload_epi64(reinterpret_cast<const long long*>(values), mask);
+}
+
+
+CONNECT4_TARGET_AVX2 static inline void storeAvx2(uint64_t* values, size_t remaining, __m256i mask, __m256i vector) {
+    if (remaining >= 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), vector);
+    } else {
+        _mm256_maskstore_epi64(reinterpret_cast<long long*>(values), mask, vector);
+    }
+}
+
+
+template <bool ofOpponent>
+CONNECT4_TARGET_AVX2 static inline __m256i loadStonesAvx2(__m256i total, const uint64_t* players, size_t remaining, __m256i mask) {
+    const __m256i player = loadAvx2(players, remaining, mask);
+    return ofOpponent ? _mm256_xor_si256(total, player) : player;
+}
+
+
+template <int shift>
+CONNECT4_TARGET_AVX2 static inline __m256i getFoursAvx2(__m256i stones) {
+    const __m256i pairs = _mm256_and_si256(stones, _mm256_srli_epi64(stones, shift));
+    return _mm256_and_si256(pairs, _mm256_srli_epi64(pairs, 2 * shift));
+}
+
+
+template <int shift>
+CONNECT4_TARGET_AVX2 static inline __m256i getAlignedCellsAvx2(__m256i stones) {
+    __m256i pair = _mm256_and_si256(_mm256_slli_epi64(stones, shift), _mm256_slli_epi64(stones, 2 * shift));
+    __m256i cells = _mm256_and_si256(pair, _mm256_slli_epi64(stones, 3 * shift));
+    cells = _mm256_or_si256(cells, _mm256_and_si256(pair, _mm256_srli_epi64(stones, shift)));
+    pair = _mm256_and_si256(_mm256_srli_epi64(stones, shift), _mm256_srli_epi64(stones, 2 * shift));
+    cells = _mm256_or_si256(cells, _mm256_and_si256(pair, _mm256_slli_epi64(stones, shift)));
+    return _mm256_or_si256(cells, _mm256_and_si256(pair, _mm256_srli_epi64(stones, 3 * shift)));
+}
+
+
+template <bool ofOpponent>
+CONNECT4_TARGET_AVX2 static void getWinsAvx2(const uint64_t* totals, const uint64_t* players, size_t size, bool* wins) {
+    for (size_t i = 0; i < size; i += 4) {
+        const __m256i mask = getLaneMaskAvx2(size - i);
+        const __m256i total = loadAvx2(totals + i, size - i, mask);
+        const __m256i stones = loadStonesAvx2<ofOpponent>(total, players + i, size - i, mask);
+
+        __m256i fours = getFoursAvx2<HORIZONTAL>(stones);
+        fours = _mm256_or_si256(fours, getFoursAvx2<DIAGONAL_DOWN>(stones));
+        fours = _mm256_or_si256(fours, getFoursAvx2<DIAGONAL_UP>(stones));
+        fours = _mm256_or_si256(fours, getFoursAvx2<VERTICAL>(stones));
+
+        const __m256i isEmpty = _mm256_cmpeq_epi64(fours, _mm256_setzero_si256());
+        const int emptyLanes = _mm256_movemask_pd(_mm256_castsi256_pd(isEmpty));
+        const size_t numLanes = size - i < 4 ? size - i : 4;
+        for (size_t lane = 0; lane < numLanes; ++lane) {
+            wins[i + lane] = !((emptyLanes >> lane) & 1);
+        }
+    }
+}
+
+
+template <bool ofOpponent>
+CONNECT4_TARGET_AVX2 static void getWinningCellsAvx2(const uint64_t* totals, const uint64_t* players, size_t size, uint64_t* cells) {
+    const __m256i boardMask = _mm256_set1_epi64x(static_cast<long long>(Board::BOARD_MASK));
+    for (size_t i = 0; i < size; i += 4) {
+        const __m256i mask = getLaneMaskAvx2(size - i);
+        const __m256i total = loadAvx2(totals + i, size - i, mask);
+        const __m256i stones = loadStonesAvx2<ofOpponent>(total, players + i, size - i, mask);
+
+        __m256i result = _mm256_and_si256(_mm256_slli_epi64(stones, 1), _mm256_slli_epi64(stones, 2));
+        result = _mm256_and_si256(result, _mm256_slli_epi64(stones, 3));
+        result = _mm256_or_si256(result, getAlignedCellsAvx2<HORIZONTAL>(stones));
+        result = _mm256_or_si256(result, getAlignedCellsAvx2<DIAGONAL_DOWN>(stones));
+        result = _mm256_or_si256(result, getAlignedCellsAvx2<DIAGONAL_UP>(stones));
+        result = _mm256_andnot_si256(total, _mm256_and_si256(result, boardMask));
+
+        storeAvx2(cells + i, size - i, mask, result);
+    }
+}
+
+
+CONNECT4_TARGET_AVX2 static void getPossibleMovesAvx2(const uint64_t* totals, size_t size, uint64_t* moves) {
+    const __m256i bottomMask = _mm256_set1_epi64x(static_cast<long long>(Board::BOTTOM_MASK));
+    const __m256i boardMask = _mm256_set1_epi64x(static_cast<long long>(Board::BOARD_MASK));
+    for (size_t i = 0; i < size; i += 4) {
+        const __m256i mask = getLaneMaskAvx2(size - i);
+        const __m256i total = loadAvx2(totals + i, size - i, mask);
+        const __m256i result = _mm256_and_si256(_mm256_add_epi64(total, bottomMask), boardMask);
+        storeAvx2(moves + i, size - i, mask, result);
+    }
+}
+
+
+// The AVX-512 kernels repeat the AVX2 ones on 8 boards at once, with mask registers for the last vector.
+// GCC's unmasked AVX-512 intrinsics merge into an undefined vector, which it reports as uninitialized.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+CONNECT4_TARGET_AVX512 static inline __mmask8 getLaneMaskAvx512(size_t remaining) {
+    return remaining >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+
+template <bool ofOpponent>
+CONNECT4_TARGET_AVX512 static inline __m512i loadStonesAvx512(__m512i total, const uint64_t* players, __mmask8 mask) {
+    const __m512i player = _mm512_maskz_loadu_epi64(mask, players);
+    return ofOpponent ? _mm512_xor_si512(total, player) : player;
+}
+
+
+template <int shift>
+CONNECT4_TARGET_AVX512 static inline __m512i getFoursAvx512(__m512i stones) {
+    const __m512i pairs = _mm512_and_si512(stones, _mm512_srli_epi64(stones, shift));
+    return _mm512_and_si512(pairs, _mm512_srli_epi64(pairs, 2 * shift));
+}
+
+
+template <int shift>
+CONNECT4_TARGET_AVX512 static inline __m512i getAlignedCellsAvx512(__m512i stones) {
+    __m512i pair = _mm512_and_si512(_mm512_slli_epi64(stones, shift), _mm512_slli_epi64(stones, 2 * shift));
+    __m512i cells = _mm512_and_si512(pair, _mm512_slli_epi64(stones, 3 * shift));
+    cells = _mm512_or_si512(cells, _mm512_and_si512(pair, _mm512_srli_epi64(stones, shift)));
+    pair = _mm512_and_si512(_mm512_srli_epi64(stones, shift), _mm512_srli_epi64(stones, 2 * shift));
+    cells = _mm512_or_si512(cells, _mm512_and_si512(pair, _mm512_slli_epi64(stones, shift)));
+    return _mm512_or_si512(cells, _mm512_and_si512(pair, _mm512_srli_epi64(stones, 3 * shift)));
+}
+
+
+template <bool ofOpponent>
+CONNECT4_TARGET_AVX512 static void getWinsAvx512(const uint64_t* totals, const uint64_t* players, size_t size, bool* wins) {
+    for (size_t i = 0; i < size; i += 8) {
+        const __mmask8 mask = getLaneMaskAvx512(size - i);
+        const __m512i total = _mm512_maskz_loadu_epi64(mask, totals + i);
+        const __m512i stones = loadStonesAvx512<ofOpponent>(total, players + i, mask);
+
+        __m512i fours = getFoursAvx512<HORIZONTAL>(stones);
+        fours = _mm512_or_si512(fours, getFoursAvx512<DIAGONAL_DOWN>(stones));
+        fours = _mm512_or_si512(fours, getFoursAvx512<DIAGONAL_UP>(stones));
+        fours = _mm512_or_si512(fours, getFoursAvx512<VERTICAL>(stones));
+
+        const __mmask8 winLanes = _mm512_test_epi64_mask(fours, fours);
+        const size_t numLanes = size - i < 8 ? size - i : 8;
+        for (size_t lane = 0; lane < numLanes; ++lane) {
+            wins[i + lane] = (winLanes >> lane) & 1;
+        }
+    }
+}
+
+
+template <bool ofOpponent>
+CONNECT4_TARGET_AVX512 static void getWinningCellsAvx512(const uint64_t* totals, const uint64_t* players, size_t size, uint64_t* cells) {
+    const __m512i boardMask = _mm512_set1_epi64(static_cast<long long>(Board::BOARD_MASK));
+    for (size_t i = 0; i < size; i += 8) {
+        const __mmask8 mask = getLaneMaskAvx512(size - i);
+        const __m512i total = _mm512_maskz_loadu_epi64(mask, totals + i);
+        const __m512i stones = loadStonesAvx512<ofOpponent>(total, players + i, mask);
+
+        __m512i result = _mm512_and_si512(_mm512_slli_epi64(stones, 1), _mm512_slli_epi64(stones, 2));
+        result = _mm512_and_si512(result, _mm512_slli_epi64(stones, 3));
+        result = _mm512_or_si512(result, getAlignedCellsAvx512<HORIZONTAL>(stones));
+        result = _mm512_or_si512(result, getAlignedCellsAvx512<DIAGONAL_DOWN>(stones));
+        result = _mm512_or_si512(result, getAlignedCellsAvx512<DIAGONAL_UP>(stones));
+        result = _mm512_andnot_si512(total, _mm512_and_si512(result, boardMask));
+
+        _mm512_mask_storeu_epi64(cells + i, mask, result);
+    }
+}
+
+
+CONNECT4_TARGET_AVX512 static void getPossibleMovesAvx512(const uint64_t* totals, size_t size, uint64_t* moves) {
+    const __m512i bottomMask = _mm512_set1_epi64(static_cast<long long>(Board::BOTTOM_MASK));
+    const __m512i boardMask = _mm512_set1_epi64(static_cast<long long>(Board::BOARD_MASK));
+    for (size_t i = 0; i < size; i += 8) {
+        const __mmask8 mask = getLaneMaskAvx512(size - i);
+        const __m512i total = _mm512_maskz_loadu_epi64(mask, totals + i);
+        const __m512i result = _mm512_and_si512(_mm512_add_epi64(total, bottomMask), boardMask);
+        _mm512_mask_storeu_epi64(moves + i, mask, result);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+
+static BoardBatch::InstructionSet getSupportedInstructionSet() {
+#if CONNECT4_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return BoardBatch::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return BoardBatch::AVX2;
+    }
+#endif
+    return BoardBatch::SCALAR;
+}
+
+
+// Detected on first use, so it is ready even for batches built during static initialization
+static std::atomic<BoardBatch::InstructionSet>& getSelectedInstructionSet() {
+    static std::atomic<BoardBatch::InstructionSet> instructionSet{getSupportedInstructionSet()};
+    return instructionSet;
+}
+
+
+template <bool ofOpponent>
+static void getWins(const uint64_t* totals, const uint64_t* players, size_t size, bool* wins) {
+    switch (BoardBatch::getInstructionSet()) {
+#if CONNECT4_BATCH_X86
+        case BoardBatch::AVX512:
+            getWinsAvx512<ofOpponent>(totals, players, size, wins);
+            return;
+        case BoardBatch::AVX2:
+            getWinsAvx2<ofOpponent>(totals, players, size, wins);
+            return;
+#endif
+        default:
+            getWinsScalar<ofOpponent>(totals, players, size, wins);
+            return;
+    }
+}
+
+
+template <bool ofOpponent>
+static void getWinningCells(const uint64_t* totals, const uint64_t* players, size_t size, uint64_t* cells) {
+    switch (BoardBatch::getInstructionSet()) {
+#if CONNECT4_BATCH_X86
+        case BoardBatch::AVX512:
+            getWinningCellsAvx512<ofOpponent>(totals, players, size, cells);
+            return;
+        case BoardBatch::AVX2:
+            getWinningCellsAvx2<ofOpponent>(totals, players, size, cells);
+            return;
+#endif
+        default:
+            getWinningCellsScalar<ofOpponent>(totals, players, size, cells);
+            return;
+    }
+}
+
+
+BoardBatch::BoardBatch(const std::vector<Board>& boards) {
+    reserve(boards.size());
+    for (const Board& board : boards) {
+        push(board);
+    }
+}
+
+
+void BoardBatch::getPlayerWins(bool* wins) const {
+    getWins<false>(_totalBoards.data(), _playerBoards.data(), size(), wins);
+}
+
+
+void BoardBatch::getOpponentWins(bool* wins) const {
+    getWins<true>(_totalBoards.data(), _playerBoards.data(), size(), wins);
+}
+
+
+void BoardBatch::getPlayerWinningCells(uint64_t* cells) const {
+    getWinningCells<false>(_totalBoards.data(), _playerBoards.data(), size(), cells);
+}
+
+
+void BoardBatch::getOpponentWinningCells(uint64_t* cells) const {
+    getWinningCells<true>(_totalBoards.data(), _playerBoards.data(), size(), cells);
+}
+
+
+void BoardBatch::getPossibleMoves(uint64_t* moves) const {
+    switch (getInstructionSet()) {
+#if CONNECT4_BATCH_X86
+        case AVX512:
+            getPossibleMovesAvx512(_totalBoards.data(), size(), moves);
+            return;
+        case AVX2:
+            getPossibleMovesAvx2(_totalBoards.data(), size(), moves);
+            return;
+#endif
+        default:
+            getPossibleMovesScalar(_totalBoards.data(), size(), moves);
+            return;
+    }
+}
+
+
+BoardBatch::InstructionSet BoardBatch::getInstructionSet() {
+    return getSelectedInstructionSet().load(std::memory_order_relaxed);
+}
+
+
+bool BoardBatch::setInstructionSet(InstructionSet instructionSet) {
+    if (instructionSet > getSupportedInstructionSet()) {
+        return false;
+    }
+
+    getSelectedInstructionSet().store(instructionSet, std::memory_order_relaxed);
+    return true;
+}
+
+
+const char* BoardBatch::getInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case AVX2:
+            return "avx2";
+        case AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,152 @@
+#include <connect4/endgame_table.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace connect4;
+
+
+constexpr char EndgameTable::MAGIC[4];
+
+
+bool EndgameTable::load(const std::string& path) {
+    unload();
+
+    if (!_file.open(path)) {
+        return false;
+    }
+
+    if (_file.getSize() < sizeof(Header)) {
+        unload();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, _file.getData(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+            || header.maxEmptyCells == 0 || header.maxEmptyCells > 42 || header.indexBits > MAX_INDEX_BITS) {
+        unload();
+        return false;
+    }
+
+    // The index and the entry count are bounded by the file size before the exact size is compared,
+    // so damaged sizes cannot wrap the check or place the index outside the file
+    const size_t dataBytes = _file.getSize() - sizeof(Header);
+    const size_t indexBytes = _getIndexBytes(header.indexBits);
+    if (indexBytes > dataBytes || header.numEntries > (dataBytes - indexBytes) / sizeof(uint64_t)
+            || dataBytes != indexBytes + header.numEntries * sizeof(uint64_t)) {
+        unload();
+        return false;
+    }
+
+    // Probes trust the index, so every bucket must lie within the entries
+    const uint32_t* index = reinterpret_cast<const uint32_t*>(_file.getData() + sizeof(Header));
+    const size_t numBuckets = size_t(1) << header.indexBits;
+    if (index[0] != 0 || index[numBuckets] != header.numEntries) {
+        unload();
+        return false;
+    }
+    for (size_t bucket = 0; bucket < numBuckets; ++bucket) {
+        if (index[bucket] > index[bucket + 1]) {
+            unload();
+            return false;
+        }
+    }
+
+    _index = index;
+    _entries = reinterpret_cast<const uint64_t*>(_file.getData() + sizeof(Header) + indexBytes);
+    _numEntries = static_cast<size_t>(header.numEntries);
+    _indexShift = static_cast<uint8_t>(64 - header.indexBits);
+    _maxEmptyCells = static_cast<uint8_t>(header.maxEmptyCells);
+    return true;
+}
+
+
+void EndgameTable::unload() {
+    _file.close();
+    _index = nullptr;
+    _entries = nullptr;
+    _numEntries = 0;
+    _indexShift = 64;
+    _maxEmptyCells = 0;
+}
+
+
+bool EndgameTable::probe(const Board& board, int8_t& score) const {
+    if (!_entries) {
+        return false;
+    }
+
+    bool isMirrored;
+    const uint64_t key = board.getCanonicalKey(isMirrored);
+
+    // Entries of a bucket are sorted by key
+    const size_t bucket = _getBucket(key, _indexShift);
+    const uint64_t* end = _entries + _index[bucket + 1];
+    for (const uint64_t* it = _entries + _index[bucket]; it != end; ++it) {
+        const uint64_t entryKey = *it & KEY_MASK;
+        if (entryKey >= key) {
+            if (entryKey != key) {
+                return false;
+            }
+            score = static_cast<int8_t>(*it >> 56);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool EndgameTable::write(const std::string& path, uint8_t maxEmptyCells, std::vector<std::pair<uint64_t, int8_t>> entries) {
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const std::pair<uint64_t, int8_t>& a, const std::pair<uint64_t, int8_t>& b) {
+        return a.first == b.first;
+    }), entries.end());
+
+    if (entries.size() > UINT32_MAX) {
+        return false;
+    }
+
+    uint32_t indexBits = 0;
+    while (indexBits < MAX_INDEX_BITS && (size_t(1) << indexBits) * BUCKET_ENTRIES < entries.size()) {
+        indexBits++;
+    }
+    const uint8_t indexShift = static_cast<uint8_t>(64 - indexBits);
+
+    // Group by bucket, stable so each bucket stays sorted by key
+    std::stable_sort(entries.begin(), entries.end(), [indexShift](const std::pair<uint64_t, int8_t>& a, const std::pair<uint64_t, int8_t>& b) {
+        return _getBucket(a.first, indexShift) < _getBucket(b.first, indexShift);
+    });
+
+    std::vector<uint32_t> index(_getIndexBytes(indexBits) / sizeof(uint32_t), 0);
+    const size_t numBuckets = size_t(1) << indexBits;
+    size_t next = 0;
+    for (size_t bucket = 0; bucket <= numBuckets; ++bucket) {
+        while (next < entries.size() && _getBucket(entries[next].first, indexShift) < bucket) {
+            next++;
+        }
+        index[bucket] = static_cast<uint32_t>(next);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.maxEmptyCells = maxEmptyCells;
+    header.indexBits = indexBits;
+    header.numEntries = entries.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint32_t));
+
+    for (const std::pair<uint64_t, int8_t>& entry : entries) {
+        uint64_t packed = (entry.first & KEY_MASK) | (static_cast<uint64_t>(static_cast<uint8_t>(entry.second)) << 56);
+        file.write(reinterpret_cast<const char*>(&packed), sizeof(packed));
+    }
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,24 @@
+#include <connect4/engine_host.h>
+
+#include <thread>
+
+using namespace connect4;
+
+
+static size_t getDefaultNumThreads() {
+    const unsigned int numThreads = std::thread::hardware_concurrency();
+    return numThreads == 0 ? 1 : numThreads;
+}
+
+
+EngineHost::EngineHost(size_t numThreads) : _pool(numThreads == 0 ? getDefaultNumThreads() : numThreads) {}
+
+
+bool EngineHost::loadOpeningBook(const std::string& path) {
+    return _openingBook.load(path);
+}
+
+
+bool EngineHost::loadEndgameTable(const std::string& path) {
+    return _endgameTable.load(path);
+}
@@ -0,0 +1,96 @@
+#include <connect4/opening_book.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace connect4;
+
+
+constexpr char OpeningBook::MAGIC[4];
+
+
+bool OpeningBook::load(const std::string& path) {
+    unload();
+
+    if (!_file.open(path)) {
+        return false;
+    }
+
+    if (_file.getSize() < sizeof(Header)) {
+        unload();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, _file.getData(), sizeof(Header));
+    // The entry count is bounded by the file size first, so a damaged count cannot wrap the size check
+    const size_t maxEntries = (_file.getSize() - sizeof(Header)) / sizeof(uint64_t);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+            || header.numEntries > maxEntries || _file.getSize() != sizeof(Header) + header.numEntries * sizeof(uint64_t)) {
+        unload();
+        return false;
+    }
+
+    _entries = reinterpret_cast<const uint64_t*>(_file.getData() + sizeof(Header));
+    _numEntries = static_cast<size_t>(header.numEntries);
+    _maxPly = static_cast<uint8_t>(header.maxPly);
+    return true;
+}
+
+
+void OpeningBook::unload() {
+    _file.close();
+    _entries = nullptr;
+    _numEntries = 0;
+    _maxPly = 0;
+}
+
+
+bool OpeningBook::probe(const Board& board, int8_t& score) const {
+    if (!_entries) {
+        return false;
+    }
+
+    bool isMirrored;
+    const uint64_t key = board.getCanonicalKey(isMirrored);
+
+    const uint64_t* end = _entries + _numEntries;
+    const uint64_t* it = std::lower_bound(_entries, end, key, [](uint64_t entry, uint64_t key) {
+        return (entry & KEY_MASK) < key;
+    });
+    if (it == end || (*it & KEY_MASK) != key) {
+        return false;
+    }
+
+    score = static_cast<int8_t>(*it >> 56);
+    return true;
+}
+
+
+bool OpeningBook::write(const std::string& path, uint8_t maxPly, std::vector<std::pair<uint64_t, int8_t>> entries) {
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const std::pair<uint64_t, int8_t>& a, const std::pair<uint64_t, int8_t>& b) {
+        return a.first == b.first;
+    }), entries.end());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.maxPly = maxPly;
+    header.reserved = 0;
+    header.numEntries = entries.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+    for (const std::pair<uint64_t, int8_t>& entry : entries) {
+        uint64_t packed = (entry.first & KEY_MASK) | (static_cast<uint64_t>(static_cast<uint8_t>(entry.second)) << 56);
+        file.write(reinterpret_cast<const char*>(&packed), sizeof(packed));
+    }
+
+    return static_cast<bool>(file);
+}
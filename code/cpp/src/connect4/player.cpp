@@ -1,240 +1,652 @@
 #include <connect4/player.h>
+#include <connect4/board_batch.h>
+#include <connect4/engine_host.h>
+#include <utils/bits.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 
 using namespace connect4;
 
 
+// Central columns take part in the most alignments, so they are tried first when nothing else ranks moves
+static constexpr uint8_t COLUMN_ORDER[7] = {3, 2, 4, 1, 5, 0, 6};
+
+// Nodes visited by the calling thread, added to the player's count once per root move
+static thread_local uint64_t threadNodeCount = 0;
+
+#if CONNECT4_SEARCH_STATS
+// Nodes failing high in the calling thread, and those failing high on their first move
+static thread_local uint64_t threadCutoffCount = 0;
+static thread_local uint64_t threadFirstMoveCutoffCount = 0;
+#endif
+
+// Nodes between two reads of the clock, a fraction of a millisecond of search
+static constexpr uint64_t TIME_CHECK_INTERVAL = 1024;
+
+
 Player::Player() : _board() {}
 
 
+Player::Player(EngineHost& host) : _board(), _host(&host), _memo(host.getSessionMemoBudgetBytes()) {}
+
+
 Player::~Player() {
     _endThreads = true;
+    // Pairs with the fence in _startSearchClock, so a search starting now cannot clear the time-out again
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _isTimeOut = true;
+    _stopPonder = true;
+    _waitForHostedTurns();
 
-    _timerCV.notify_one();
     _idleSearchCV.notify_one();
-    _gameCV.notify_one();
+    _notifyGameThread();
     
-    if (_timerThread.joinable()) _timerThread.join();
     if (_idleSearchThread.joinable()) _idleSearchThread.join();
     if (_gameThread.joinable()) _gameThread.join();
 }
 
 
+// Side to move's view of a board, resolved at compile time so one search kernel serves both sides.
+// Memo keys use the stones of the side to move as the player stones, like the opening book, so an
+// entry means the same position whichever side the player plays.
+template <Player::Turn side>
+static inline bool otherSideWins(const Board& board) {
+    if constexpr (side == Player::PLAYER) {
+        return board.opponentWins();
+    } else {
+        return board.playerWins();
+    }
+}
+
+template <Player::Turn side>
+static inline uint64_t getWinningCells(const Board& board) {
+    if constexpr (side == Player::PLAYER) {
+        return board.getPlayerWinningCells();
+    } else {
+        return board.getOpponentWinningCells();
+    }
+}
+
+template <Player::Turn side>
+static inline uint64_t getNonLosingMoves(const Board& board) {
+    if constexpr (side == Player::PLAYER) {
+        return board.getPlayerNonLosingMoves();
+    } else {
+        return board.getOpponentNonLosingMoves();
+    }
+}
+
+template <Player::Turn side>
+static inline void playStone(Position& position, uint8_t col) {
+    if constexpr (side == Player::PLAYER) {
+        position.playPlayer(col);
+    } else {
+        position.playOpponent(col);
+    }
+}
+
+template <Player::Turn side>
+static inline Board getMoverBoard(const Board& board) {
+    if constexpr (side == Player::PLAYER) {
+        return board;
+    } else {
+        return board.getSwapped();
+    }
+}
+
+template <Player::Turn side>
+static inline uint64_t getMemoKey(const Board& board, bool& isMirrored) {
+    if constexpr (side == Player::PLAYER) {
+        return board.getCanonicalKey(isMirrored);
+    } else {
+        return board.getSwapped().getCanonicalKey(isMirrored);
+    }
+}
+
+
 // Refer to https://en.wikipedia.org/wiki/Negamax#Negamax_with_alpha_beta_pruning_and_transposition_tables
-int8_t Player::_negamaxPlayer(const Board& board, uint8_t depth, int8_t alpha, int8_t beta) {
-    if (_isTimeOut) {
+// side is the side to move, fixed at compile time so the side-specific board calls are resolved statically
+template <Player::Turn side>
+int8_t Player::_negamax(const SearchContext& context, Position& position, int8_t alpha, int8_t beta) {
+    if (context.isTimeOut) {
         // Searched time exceeded, return neutral score
         return 0;
     }
+    // A node budget is checked at every node, so it stops at the same node whatever the thread counted before
+    if ((++threadNodeCount & (TIME_CHECK_INTERVAL - 1)) == 0 || context.isNodeClock) {
+        context.checkDeadline(threadNodeCount);
+    }
 
-    {
-        std::lock_guard<std::mutex> lock(_memoMutex);
+    // Children are pushed above this node's board on position, so board stays valid while they are searched
+    const Board& board = position.getBoard();
+    const uint8_t depth = position.getNumMoves();
 
-        auto it = _memo.find(board);
-        if (it == _memo.end()) {
-            it = _memo.emplace(board, SearchResult{0, NOT_SET}).first;
-        } else {
-            switch (it->second.flag) {
-                case EXACT:
-                    return it->second.score;
-                case LOWERBOUND:
-                    if (it->second.score >= beta) {
-                        return it->second.score;
-                    }
-                    break;
-                case UPPERBOUND:
-                    if (it->second.score <= alpha) {
-                        return it->second.score;
-                    }
-                    break;
-                default:
-                    break;
-            }
+    // The previous move won the game for the other side
+    if (otherSideWins<side>(board)) {
+        return -context.getScore(depth);
+    }
+
+    if (board.isDraw()) {
+        return 0;
+    }
+
+    // Winning with the next stone needs no search
+    if (board.getPossibleMoves() & getWinningCells<side>(board)) {
+        return context.getScore(depth + 1);
+    }
+
+    // Every move lets the other side win with its next stone
+    const uint64_t nonLosingMoves = getNonLosingMoves<side>(board);
+    if (!nonLosingMoves) {
+        return -context.getScore(depth + 2);
+    }
+
+    // Late positions may have an exact score in the endgame table, even at the horizon. Its wins and losses
+    // may come long after the horizon, so they are raised above the evaluation range like solved memo scores.
+    if (context.isEndgameTableEntry(depth)) {
+        int8_t score;
+        if (context.endgameTable->probe(getMoverBoard<side>(board), score)) {
+            return context.getProvenScore(score, 0);
+        }
+    }
+
+    if (depth == context.maxDepth) {
+        return context.getHorizonScore(getMoverBoard<side>(board));
+    }
+
+    bool isMirrored;
+    const uint64_t key = getMemoKey<side>(board, isMirrored);
+    const uint8_t remainingDepth = context.getRemainingDepth(depth);
+
+    SearchResult entry;
+    if (_memo.probe(key, entry) && context.isUsable(entry, remainingDepth)) {
+        // The entry's search had its horizon entry.depth below the node, or none for a solved entry. Any
+        // bound maps to a bound of the raised score, as raising keeps scores in order.
+        const int8_t entryLimit = entry.depth == TranspositionTable::DEPTH_SOLVED ? 0 : context.getEvaluationLimit(depth + entry.depth);
+        const int8_t score = context.getProvenScore(entry.score, entryLimit);
+        switch (entry.flag) {
+            case EXACT:
+                return score;
+            case LOWERBOUND:
+                if (score >= beta) {
+                    return score;
+                }
+                break;
+            case UPPERBOUND:
+                if (score <= alpha) {
+                    return score;
+                }
+                break;
+            default:
+                break;
         }
+    }
 
-        if (board.opponentWins()) {
-            int8_t score = _getScore(depth);
-            it->second.score = score;
-            it->second.flag = EXACT;
-            return score;
+    // Neither side wins with its next stone, so the best case is winning with the stone after, and the
+    // worst is losing to the other side's second stone. Both are capped by a draw near the end of the game.
+    const int8_t bestPossible = std::max<int8_t>(context.getScore(depth + 3), 0);
+    if (beta > bestPossible) {
+        beta = bestPossible;
+        if (alpha >= beta) {
+            return beta;
         }
-        
-        if (board.isDraw()) {
-            it->second.score = 0;
-            it->second.flag = EXACT;
-            return 0;
-        } 
     }
-    
-    if (depth == _maxDepth) {
-        return 0;
+
+    const int8_t worstPossible = std::min<int8_t>(-context.getScore(depth + 4), 0);
+    if (alpha < worstPossible) {
+        alpha = worstPossible;
+        if (alpha >= beta) {
+            return alpha;
+        }
     }
 
+    // The memo's best move is stored for the canonical orientation
+    if (isMirrored && entry.bestMove != SearchResult::NO_MOVE) {
+        entry.bestMove = 6 - entry.bestMove;
+    }
+
+    uint8_t moves[7];
+    const uint8_t numMoves = _orderMoves(board, side, nonLosingMoves, entry.bestMove, moves);
+
+    constexpr Turn OTHER_SIDE = side == PLAYER ? OPPONENT : PLAYER;
+
     int8_t originalAlpha = alpha;
     int8_t maxScore = MIN_SCORE;
-    for (uint8_t col = 0; col < 7; ++col) {
-        if (board.isColumnFull(col)) {
-            continue;
+    uint8_t bestMove = SearchResult::NO_MOVE;
+    for (uint8_t i = 0; i < numMoves; ++i) {
+        const uint8_t col = moves[i];
+        const bool isFirstMove = i == 0;
+
+        playStone<side>(position, col);
+
+        // Principal variation search: later moves only have to prove they are no better than
+        // alpha with a null window, and are searched again with the full window when they are
+        int8_t score;
+        if (isFirstMove) {
+            score = -_negamax<OTHER_SIDE>(context, position, -beta, -alpha);
+        } else {
+            score = -_negamax<OTHER_SIDE>(context, position, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) {
+                score = -_negamax<OTHER_SIDE>(context, position, -beta, -alpha);
+            }
         }
 
-        Board newBoard = board;
-        newBoard.placePlayer(col);
+        position.undo();
 
-        int8_t score = -_negamaxOpponent(newBoard, depth + 1, -beta, -alpha);
-        if (_isTimeOut) {
+        if (context.isTimeOut) {
             return 0;
         }
 
         if (score > maxScore) {
             maxScore = score;
+            bestMove = col;
             if (maxScore > alpha) {
                 alpha = maxScore;
                 if (alpha >= beta) {
+#if CONNECT4_SEARCH_STATS
+                    threadCutoffCount++;
+                    threadFirstMoveCutoffCount += isFirstMove;
+#endif
+                    _updateHistory(board, side, col, remainingDepth);
                     break;
                 }
             }
         }
     }
 
-    {
-        std::lock_guard<std::mutex> lock(_memoMutex);
-        auto& entry = _memo[board];
-        entry.score = maxScore;
-        if (maxScore <= originalAlpha) {
-            entry.flag = UPPERBOUND;
-        } else if (maxScore >= beta) {
-            entry.flag = LOWERBOUND;
-        } else {
-            entry.flag = EXACT;
-        }
+    SearchResult result;
+    result.score = maxScore;
+    result.depth = remainingDepth;
+    result.bestMove = (isMirrored && bestMove != SearchResult::NO_MOVE) ? 6 - bestMove : bestMove;
+    result.evaluation = context.evaluation;
+    if (maxScore <= originalAlpha) {
+        result.flag = UPPERBOUND;
+    } else if (maxScore >= beta) {
+        result.flag = LOWERBOUND;
+    } else {
+        result.flag = EXACT;
     }
+    _memo.store(key, context.rootPly + depth, result);
 
     return maxScore;
 }
 
 
-int8_t Player::_negamaxOpponent(const Board& board, uint8_t depth, int8_t alpha, int8_t beta) {
-    if (_isTimeOut) {
-        // Searched time exceeded, return neutral score
-        return 0;
-    }
+// Fills moves with the candidate columns, best candidates first: the memo's best move, then moves
+// creating the most cells that would complete four, then moves that caused the most cutoffs so far.
+// Ties keep the center-out column order.
+uint8_t Player::_orderMoves(const Board& board, Turn side, uint64_t candidates, uint8_t bestMove, uint8_t* moves) const {
+    const uint64_t total = board.getTotalBoard();
+    const uint64_t stones = side == PLAYER ? board.getPlayerBoard() : board.getOpponentBoard();
 
-    {
-        std::lock_guard<std::mutex> lock(_memoMutex);
+    uint64_t ranks[7];
+    uint8_t numMoves = 0;
+    for (uint8_t col : COLUMN_ORDER) {
+        const uint64_t move = candidates & Board::columnMask(col);
+        if (!move) {
+            continue;
+        }
 
-        auto it = _memo.find(board);
-        if (it == _memo.end()) {
-            it = _memo.emplace(board, SearchResult{0, NOT_SET}).first;
+        uint64_t rank;
+        if (col == bestMove) {
+            rank = UINT64_MAX;
         } else {
-            switch (it->second.flag) {
-                case EXACT:
-                    return it->second.score;
-                case LOWERBOUND:
-                    if (it->second.score >= beta) {
-                        return it->second.score;
-                    }
-                    break;
-                case UPPERBOUND:
-                    if (it->second.score <= alpha) {
-                        return it->second.score;
-                    }
-                    break;
-                default:
-                    break;
-            }
+            uint64_t threats = utils::popCount(Board::getWinningCells(stones | move, total | move));
+            uint32_t history = _history[_getHistoryIndex(side, move)].load(std::memory_order_relaxed);
+            rank = (threats << 32) | history;
         }
 
-        if (board.playerWins()) {
-            int8_t score = _getScore(depth);
-            it->second.score = score;
-            it->second.flag = EXACT;
-            return score;
+        // Insertion sort, stable so equal ranks keep the column order
+        uint8_t i = numMoves++;
+        for (; i > 0 && ranks[i - 1] < rank; --i) {
+            ranks[i] = ranks[i - 1];
+            moves[i] = moves[i - 1];
         }
-        
-        if (board.isDraw()) {
-            it->second.score = 0;
-            it->second.flag = EXACT;
+        ranks[i] = rank;
+        moves[i] = col;
+    }
+
+    return numMoves;
+}
+
+
+void Player::_updateHistory(const Board& board, Turn side, uint8_t col, uint8_t remainingDepth) {
+    const uint64_t move = board.getPossibleMoves() & Board::columnMask(col);
+    const uint32_t bonus = static_cast<uint32_t>(remainingDepth) * remainingDepth;
+
+    // Lost updates from concurrent searches only blur the ordering, so a plain load and store is enough
+    std::atomic<uint32_t>& history = _history[_getHistoryIndex(side, move)];
+    history.store(history.load(std::memory_order_relaxed) + bonus, std::memory_order_relaxed);
+}
+
+
+// Finds the exact score of a position by bisecting the score range with null-window searches,
+// each of which only has to prove the score is above or below a single value
+template <Player::Turn side>
+int8_t Player::_solve(const SearchContext& context, Position& position) {
+    const uint8_t depth = position.getNumMoves();
+
+    // Either the side to move wins with its next stone at best, or loses to the stone after at worst
+    int8_t high = context.getScore(depth + 1);
+    int8_t low = std::min<int8_t>(-context.getScore(depth + 2), high);
+
+    while (low < high) {
+        int8_t mid = low + (high - low) / 2;
+
+        // Bias the guess towards zero, where narrower proofs are cheaper
+        if (mid <= 0 && low / 2 < mid) {
+            mid = low / 2;
+        } else if (mid >= 0 && high / 2 > mid) {
+            mid = high / 2;
+        }
+
+        int8_t score = _negamax<side>(context, position, mid, mid + 1);
+        if (context.isTimeOut) {
             return 0;
-        } 
+        }
+
+        if (score <= mid) {
+            high = score;
+        } else {
+            low = score;
+        }
     }
-    
-    if (depth == _maxDepth) {
+
+    return low;
+}
+
+
+int8_t Player::solve(const Board& board) {
+    if (_isPlaying) return 0;
+
+    utils::AtomicFlag isTimeOut{false};
+    const SearchContext context{static_cast<uint8_t>(utils::popCount(board.getTotalBoard())), 42, INT64_MAX, isTimeOut, EVALUATION_NONE, &_getEndgameTable()};
+    _memo.setRootPly(context.rootPly);
+
+    if (board.opponentWins()) {
+        return -context.getScore(0);
+    }
+
+    if (board.isDraw()) {
         return 0;
     }
 
-    int8_t originalAlpha = alpha;
-    int8_t maxScore = MIN_SCORE;
-    for (uint8_t col = 0; col < 7; ++col) {
-        if (board.isColumnFull(col)) {
-            continue;
-        }
+    _resetCounters();
+    const ThreadCounters startCounters = _getThreadCounters();
+    Position position(board);
+    const int8_t score = _solve<PLAYER>(context, position);
+    _addThreadCounters(startCounters);
 
-        Board newBoard = board;
-        newBoard.placeOpponent(col);
+    return score;
+}
 
-        int8_t score = -_negamaxPlayer(newBoard, depth + 1, -beta, -alpha);
-        if (_isTimeOut) {
-            return 0;
+
+std::vector<Player::ScoreArray> Player::analyze(const std::vector<Board>& boards, uint8_t maxDepth, uint32_t maxTimeMS, size_t numThreads) {
+    std::vector<ScoreArray> scores(boards.size());
+    _resetCounters();
+    if (boards.empty()) {
+        return scores;
+    }
+
+    if (numThreads == 0) {
+        numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    numThreads = std::min(numThreads, boards.size());
+
+    // Boards already won or lost get no scores, the wins of the whole batch are found together
+    const BoardBatch batch(boards);
+    std::unique_ptr<bool[]> playerWins(new bool[boards.size()]);
+    std::unique_ptr<bool[]> opponentWins(new bool[boards.size()]);
+    batch.getPlayerWins(playerWins.get());
+    batch.getOpponentWins(opponentWins.get());
+
+    // Each board is one task, searched on a single thread with its own context
+    utils::ThreadPool pool(numThreads - 1);
+    pool.parallelFor(boards.size(), [this, &boards, &scores, &playerWins, &opponentWins, maxDepth, maxTimeMS](size_t i) {
+        if (playerWins[i] || opponentWins[i] || boards[i].isDraw()) {
+            scores[i].fill(MIN_SCORE);
+            return;
         }
 
-        if (score > maxScore) {
-            maxScore = score;
-            if (maxScore > alpha) {
-                alpha = maxScore;
-                if (alpha >= beta) {
-                    break;
-                }
+        const ThreadCounters startCounters = _getThreadCounters();
+        _analyzeBoard(boards[i], maxDepth, maxTimeMS, scores[i]);
+        _addThreadCounters(startCounters);
+    });
+
+    return scores;
+}
+
+
+// board is neither won, lost nor drawn
+void Player::_analyzeBoard(const Board& board, uint8_t maxDepth, uint32_t maxTimeMS, ScoreArray& scores) {
+    scores.fill(MIN_SCORE);
+
+    // Moves winning the game need no search, the wins of all seven are found together once
+    BoardBatch childBatch;
+    childBatch.reserve(7);
+    for (uint8_t col = 0; col < 7; ++col) {
+        Board child = board;
+        child.placePlayer(col);
+        childBatch.push(child);
+    }
+    bool isWinningMove[7];
+    childBatch.getPlayerWins(isWinningMove);
+
+    const int64_t deadline = maxTimeMS == 0 ? INT64_MAX : _now() + static_cast<int64_t>(maxTimeMS) * 1000000;
+    maxDepth = std::max<uint8_t>(maxDepth, 1);
+
+    // The first pass ignores the deadline, so every board gets scores
+    utils::AtomicFlag isTimeOut{false};
+    SearchContext context{static_cast<uint8_t>(utils::popCount(board.getTotalBoard())), std::min<uint8_t>(4, maxDepth), INT64_MAX, isTimeOut, EVALUATION_THREATS, &_getEndgameTable()};
+
+    Position position(board);
+    ScoreArray passScores;
+    while (true) {
+        for (uint8_t col = 0; col < 7; ++col) {
+            if (board.isColumnFull(col)) {
+                passScores[col] = MIN_SCORE;
+            } else if (isWinningMove[col]) {
+                passScores[col] = context.getScore(1);
+            } else {
+                position.playPlayer(col);
+                passScores[col] = -_negamax<OPPONENT>(context, position, MIN_SCORE, MAX_SCORE);
+                position.undo();
             }
         }
+        if (isTimeOut) return;
+
+        scores = passScores;
+        if (context.maxDepth >= maxDepth) return;
+
+        context.maxDepth++;
+        context.deadline = deadline;
     }
+}
 
-    {
-        std::lock_guard<std::mutex> lock(_memoMutex);
-        auto& entry = _memo[board];
-        entry.score = maxScore;
-        if (maxScore <= originalAlpha) {
-            entry.flag = UPPERBOUND;
-        } else if (maxScore >= beta) {
-            entry.flag = LOWERBOUND;
-        } else {
-            entry.flag = EXACT;
-        }
+
+// Searches read the clock themselves every TIME_CHECK_INTERVAL nodes, so no thread has to wake up
+// while a move is being searched and a time-out is noticed within a fraction of a millisecond
+int64_t Player::_startSearchClock() {
+    const int64_t startTime = _now();
+    _searchStartTime.store(startTime, std::memory_order_relaxed);
+
+    // A player being stopped may have timed the search out already. Either _endThreads is seen set here,
+    // or the stopping thread's time-out is ordered after this store.
+    _isTimeOut = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_endThreads) {
+        _isTimeOut = true;
     }
+    _isThinking = true;
 
-    return maxScore;
+    if (_isDeterministic) {
+        return _maxNodes == 0 ? INT64_MAX : static_cast<int64_t>(threadNodeCount + _maxNodes);
+    }
+    return startTime + static_cast<int64_t>(_maxThinkingTime) * 1000000;
 }
 
 
-// Runs a timer thread in the background that sets the timeout flag after _timeOutMS milliseconds
-void Player::_timerThreadFunc() {
-    std::unique_lock<std::mutex> lock(_timerMutex);
+void Player::_stopSearchClock() {
+    _thinkingTimeNS.store(_getThinkingTimeNS(), std::memory_order_release);
+    _isThinking = false;
+}
 
-    while (true) {
-        _timerCV.wait(lock, [this]() {return _runTimer || _endThreads;});
-        if (_endThreads) {
-            _isTimeOut = true;
-            return;
+
+int64_t Player::_getThinkingTimeNS() const {
+    if (!_isThinking) {
+        return _thinkingTimeNS.load(std::memory_order_acquire);
+    }
+
+    return _now() - _searchStartTime.load(std::memory_order_relaxed);
+}
+
+
+uint32_t Player::getThinkingTimeMS() const {
+    return static_cast<uint32_t>(_getThinkingTimeNS() / 1000000);
+}
+
+
+Player::ThreadCounters Player::_getThreadCounters() {
+#if CONNECT4_SEARCH_STATS
+    return {threadNodeCount, threadCutoffCount, threadFirstMoveCutoffCount, TranspositionTable::getThreadCounters()};
+#else
+    return {threadNodeCount};
+#endif
+}
+
+
+void Player::_addThreadCounters(const ThreadCounters& start) {
+    _nodeCount.fetch_add(threadNodeCount - start.nodes, std::memory_order_relaxed);
+#if CONNECT4_SEARCH_STATS
+    _cutoffCount.fetch_add(threadCutoffCount - start.cutoffs, std::memory_order_relaxed);
+    _firstMoveCutoffCount.fetch_add(threadFirstMoveCutoffCount - start.firstMoveCutoffs, std::memory_order_relaxed);
+    _memo.addThreadCounters(start.memo);
+#endif
+}
+
+
+void Player::_resetCounters() {
+    _nodeCount.store(0, std::memory_order_relaxed);
+#if CONNECT4_SEARCH_STATS
+    _cutoffCount.store(0, std::memory_order_relaxed);
+    _firstMoveCutoffCount.store(0, std::memory_order_relaxed);
+#endif
+}
+
+
+#if CONNECT4_SEARCH_STATS
+static void setMemoStats(SearchStats& stats, const TranspositionTable::Stats& start, const TranspositionTable::Stats& end) {
+    stats.memoProbes = end.probes - start.probes;
+    stats.memoHits = end.hits - start.hits;
+    stats.memoStores = end.stores - start.stores;
+    stats.memoEvictions = end.evictions - start.evictions;
+    stats.memoCollisions = end.collisions - start.collisions;
+}
+#endif
+
+
+void Player::_beginSearchStats() {
+    _resetCounters();
+    _thinkingTimeNS.store(0, std::memory_order_release);
+
+#if CONNECT4_SEARCH_STATS
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    _searchStats = SearchStats();
+    _memoStatsAtStart = _memo.getStats();
+    _iterationStartTime = _now();
+    _iterationStartNodes = 0;
+#endif
+}
+
+
+// Called once every root column has been searched to depth, i.e. with no time-out. Pondering is not recorded.
+void Player::_recordIteration(uint8_t depth) {
+#if CONNECT4_SEARCH_STATS
+    if (!_isThinking) {
+        return;
+    }
+
+    const int64_t now = _now();
+    const uint64_t nodes = _nodeCount.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    SearchStats::Iteration iteration;
+    iteration.depth = depth;
+    iteration.nodes = nodes - _iterationStartNodes;
+    iteration.timeUS = static_cast<uint32_t>((now - _iterationStartTime) / 1000);
+    _searchStats.iterations.push_back(iteration);
+    _searchStats.completedDepth = depth;
+
+    _iterationStartTime = now;
+    _iterationStartNodes = nodes;
+#else
+    (void)depth;
+#endif
+}
+
+
+void Player::_endSearchStats(uint8_t col) {
+#if CONNECT4_SEARCH_STATS
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    setMemoStats(_searchStats, _memoStatsAtStart, _memo.getStats());
+
+    // Follow the memo's best moves from the chosen move
+    std::vector<uint8_t>& variation = _searchStats.principalVariation;
+    variation.push_back(col);
+
+    Board board = _board;
+    board.placePlayer(col);
+    Turn side = OPPONENT;
+    while (!board.playerWins() && !board.opponentWins() && !board.isDraw()) {
+        bool isMirrored;
+        SearchResult entry;
+        const Board toMove = side == PLAYER ? board : board.getSwapped();
+        if (!_memo.probe(toMove.getCanonicalKey(isMirrored), entry) || entry.bestMove == SearchResult::NO_MOVE) {
+            break;
         }
-        
-        auto startTime = std::chrono::steady_clock::now();
-        while (true) {
-            if (_endThreads) {
-                _isTimeOut = true;
-                return;
-            }
 
-            uint32_t thinkingTime = _updateThinkingTimeMS(startTime);
-            if (!_runTimer || thinkingTime >= _maxThinkingTime) {
-                _isTimeOut = true;
-                break;
-            }
+        const uint8_t move = isMirrored ? 6 - entry.bestMove : entry.bestMove;
+        if (board.isColumnFull(move)) {
+            break;
+        }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (side == PLAYER) {
+            board.placePlayer(move);
+            side = OPPONENT;
+        } else {
+            board.placeOpponent(move);
+            side = PLAYER;
         }
+        variation.push_back(move);
+    }
+#else
+    (void)col;
+#endif
+}
 
-        _runTimer = false;
+
+SearchStats Player::getSearchStats() const {
+    SearchStats stats;
+
+#if CONNECT4_SEARCH_STATS
+    {
+        std::lock_guard<std::mutex> lock(_statsMutex);
+        stats = _searchStats;
+        if (_isThinking) {
+            setMemoStats(stats, _memoStatsAtStart, _memo.getStats());
+        }
     }
+    stats.cutoffs = _cutoffCount.load(std::memory_order_relaxed);
+    stats.firstMoveCutoffs = _firstMoveCutoffCount.load(std::memory_order_relaxed);
+#endif
+
+    const int64_t timeNS = _getThinkingTimeNS();
+    stats.nodes = getNodeCount();
+    stats.timeMS = static_cast<uint32_t>(timeNS / 1000000);
+    stats.nodesPerSecond = timeNS > 0 ? static_cast<double>(stats.nodes) * 1e9 / static_cast<double>(timeNS) : 0.0;
+    return stats;
 }
 
 
@@ -242,103 +654,320 @@ void Player::_idleSearchThreadFunc() {
     std::unique_lock<std::mutex> lock(_idleSearchMutex);
     _isIdleSearching = false;
 
-    while (true) {      
+    while (true) {
         _idleSearchCV.wait(lock, [this]() {return !_pauseIdleSearch || _endThreads;});
-        
         if (_endThreads) return;
-        _pauseIdleSearch = false;
+
         _isIdleSearching = true;
+        _ponder();
+        _isIdleSearching = false;
 
-        _maxDepth = 4;
-        while (!_pauseIdleSearch) {
-            uint8_t numExact = 0;
-            for (uint8_t col = 0; col < 7; ++col) {
-                if (_endThreads) return;
-                if (_pauseIdleSearch) break;
+        // Nothing left to ponder until the player's next move resumes the thread
+        _pauseIdleSearch = true;
+    }
+}
 
-                if (_board.isColumnFull(col)) {
-                    numExact++;
-                    continue;
-                }
 
-                Board newBoard = _board;
-                newBoard.placePlayer(col);
+// Searches the positions after the opponent's most likely replies as deep as the player's move would be
+// searched, so a predicted reply is answered from these scores at once (a ponder hit). Stops as soon as
+// _stopPonder is set, and partial work still helps the next search through the memo.
+void Player::_ponder() {
+    _ponderResults.clear();
+    if (_isPlayerTurn || _board.playerWins() || _board.isDraw()) {
+        return;
+    }
 
-                {
-                    std::lock_guard<std::mutex> lock(_memoMutex);
-                    auto it = _memo.find(newBoard);
-                    if (it != _memo.end() && it->second.flag == EXACT) {
-                        numExact++;
-                        continue;
-                    }
-                }
+    uint8_t replies[7];
+    const uint8_t numReplies = _getLikelyReplies(replies);
+    for (uint8_t i = 0; i < numReplies; ++i) {
+        Board board = _board;
+        board.placeOpponent(replies[i]);
+        if (board.opponentWins() || board.isDraw()) {
+            continue;
+        }
 
-                _negamaxOpponent(newBoard, 1, MIN_SCORE, MAX_SCORE);
-            }
+        SearchContext context{static_cast<uint8_t>(_turnCount + 1), 0, INT64_MAX, _stopPonder, _evaluation, _getGameEndgameTable()};
+        ScoreArray scores;
+        scores.fill(MIN_SCORE);
+        if (_playerDifficulty == DIFFICULTY_PERFECT) {
+            _solveScores(context, board, scores);
+        } else {
+            _searchScores(context, board, scores);
+        }
+        if (_stopPonder) return;
 
-            // If all seven columns have exact scores, there is no need to continue searching deeper
-            if (numExact == 7) {
-                _pauseIdleSearch = true;
-                break;
-            }
+        _ponderResults.push_back({board, scores});
+    }
+}
+
+
+// Opponent replies to the current position, most likely first: the memo's best move (from the player's
+// last search, or a shallow search when the memo has none), then by the usual move ordering
+uint8_t Player::_getLikelyReplies(uint8_t* replies) {
+    bool isMirrored;
+    const uint64_t key = _board.getSwapped().getCanonicalKey(isMirrored);
+
+    SearchResult entry;
+    if (!_memo.probe(key, entry) || entry.bestMove == SearchResult::NO_MOVE) {
+        const SearchContext context{_turnCount, std::min<uint8_t>(_globalMaxDepth, PONDER_PREDICTION_DEPTH), INT64_MAX, _stopPonder, _evaluation, _getGameEndgameTable()};
+        Position position(_board);
+        _negamax<OPPONENT>(context, position, MIN_SCORE, MAX_SCORE);
+        _memo.probe(key, entry);
+    }
+
+    uint8_t bestReply = entry.bestMove;
+    if (isMirrored && bestReply != SearchResult::NO_MOVE) {
+        bestReply = 6 - bestReply;
+    }
 
-            _maxDepth++;
+    return _orderMoves(_board, OPPONENT, _board.getPossibleMoves(), bestReply, replies);
+}
+
+
+// Scores of the current position found while pondering, if the opponent played a predicted reply
+bool Player::_getPonderScores(ScoreArray& scores) const {
+    for (const PonderResult& result : _ponderResults) {
+        if (result.board == _board) {
+            scores = result.scores;
+            return true;
         }
+    }
+    return false;
+}
 
-        _isIdleSearching = false;
+
+// Root columns not searched to the current depth when the search timed out
+static constexpr int8_t NOT_SEARCHED = INT8_MIN;
+
+
+// Column with the best score, the most central one among equals
+static uint8_t getBestColumn(const Player::ScoreArray& scores) {
+    uint8_t bestCol = COLUMN_ORDER[0];
+    for (uint8_t col : COLUMN_ORDER) {
+        if (scores[col] > scores[bestCol]) {
+            bestCol = col;
+        }
+    }
+    return bestCol;
+}
+
+
+// Root columns with the best move of the previous iteration first, so it is the most likely
+// to have been searched to the new depth when time runs out
+static void getRootOrder(const Player::ScoreArray& scores, uint8_t* order) {
+    const uint8_t bestCol = getBestColumn(scores);
+    order[0] = bestCol;
+
+    uint8_t i = 1;
+    for (uint8_t col : COLUMN_ORDER) {
+        if (col != bestCol) {
+            order[i++] = col;
+        }
+    }
+}
+
+
+// Keeps the scores of the last completed iteration, unless the interrupted one has already searched
+// that iteration's best move and found another move doing better at the new depth
+static void mergeInterruptedIteration(Player::ScoreArray& scores, const Player::ScoreArray& iterationScores) {
+    const uint8_t previousBest = getBestColumn(scores);
+    if (iterationScores[previousBest] == NOT_SEARCHED) {
+        return;
+    }
+
+    uint8_t bestCol = previousBest;
+    for (uint8_t col : COLUMN_ORDER) {
+        if (iterationScores[col] != NOT_SEARCHED && iterationScores[col] > iterationScores[bestCol]) {
+            bestCol = col;
+        }
+    }
+
+    // Scores of different depths cannot be compared, so only rank the better move first
+    if (bestCol != previousBest) {
+        scores[bestCol] = std::max<int8_t>(iterationScores[bestCol], scores[previousBest] + 1);
     }
 }
 
 
 void Player::_getScores(ScoreArray& scores) {
-    _maxDepth = std::min<uint8_t>(4, _globalMaxDepth);
     scores.fill(MIN_SCORE);
-    if (!_allowIdleSearch) {
-        _memoMutex.lock();
-        _memo.clear();
-        _memoMutex.unlock();
+
+    SearchContext context = _getGameContext(0, _startSearchClock());
+    if (_playerDifficulty == DIFFICULTY_PERFECT) {
+        _solveScores(context, _board, scores);
+    } else {
+        _searchScores(context, _board, scores);
     }
+    _stopSearchClock();
+}
 
-    // Reset the timer
-    {
-        _runTimer = false;
 
-        // The thread will block here until the timer is fully reset
-        std::lock_guard<std::mutex> lock(_timerMutex);
+// Score of playing col on board (player to move), MIN_SCORE for a full column
+int8_t Player::_searchColumn(const SearchContext& context, const Board& board, uint8_t col) {
+    if (board.isColumnFull(col)) {
+        return MIN_SCORE;
+    }
 
-        _isTimeOut = false;
-        _runTimer = true;
-        _timerCV.notify_one();
+    Position position(board);
+    position.playPlayer(col);
+    return -_negamax<OPPONENT>(context, position, MIN_SCORE, MAX_SCORE);
+}
+
+
+void Player::_searchRootColumn(const SearchContext& context, const Board& root, ScoreArray& scores, uint8_t col) {
+    const ThreadCounters startCounters = _getThreadCounters();
+    int8_t score = _searchColumn(context, root, col);
+    // Pondering runs after the last move's counts are final and is not part of them
+    if (_isThinking) {
+        _addThreadCounters(startCounters);
     }
+    if (context.isTimeOut) return;
+
+    scores[col] = score;
+}
 
-    while (!_isTimeOut) {
-        for (uint8_t col = 0; col < 7; ++col) {
-            if (_board.isColumnFull(col)) {
-                scores[col] = MIN_SCORE;
-                continue;
-            }
 
-            Board newBoard = _board;
-            newBoard.placePlayer(col);
+// Iterative deepening up to the difficulty's maximum depth. scores only ever hold completed iterations,
+// or the best move an interrupted iteration has found (see mergeInterruptedIteration).
+void Player::_searchScores(SearchContext& context, const Board& root, ScoreArray& scores) {
+    context.maxDepth = std::min<uint8_t>(4, _globalMaxDepth);
 
-            int8_t score = -_negamaxOpponent(newBoard, 1, MIN_SCORE, MAX_SCORE);
-            if (_isTimeOut) return;
+    // The first iteration takes a fraction of a millisecond and ignores the deadline, so a move is always known
+    const int64_t deadline = context.deadline;
+    context.deadline = INT64_MAX;
 
-            scores[col] = score;
+    // Root columns are searched with independent full windows, so they can run on any thread
+    // in any order and still give the same scores as a sequential search
+    ScoreArray iterationScores;
+    uint8_t order[7];
+    const std::function<void(size_t)> searchColumn = [this, &context, &root, &iterationScores, &order](size_t i) {
+        _searchRootColumn(context, root, iterationScores, order[i]);
+    };
+
+    while (true) {
+        getRootOrder(scores, order);
+        iterationScores.fill(NOT_SEARCHED);
+
+        _searchPool->parallelFor(7, searchColumn);
+        if (context.isTimeOut) {
+            mergeInterruptedIteration(scores, iterationScores);
+            return;
+        }
+
+        scores = iterationScores;
+        _recordIteration(context.maxDepth);
+        context.deadline = deadline;
+
+        context.maxDepth++;
+        if (context.maxDepth > _globalMaxDepth) {
+            return;
         }
+    }
+}
+
 
-        _maxDepth++;
-        if (_maxDepth > _globalMaxDepth) {
-            _runTimer = false;
+void Player::_solveScores(SearchContext& context, const Board& root, ScoreArray& scores) {
+    // A shallow pass first, so running out of time still leaves a sensible move. It takes a few
+    // milliseconds and ignores the deadline.
+    const int64_t deadline = context.deadline;
+    context.deadline = INT64_MAX;
+    context.maxDepth = PERFECT_FALLBACK_DEPTH;
+    _searchPool->parallelFor(7, [this, &context, &root, &scores](size_t col) {
+        _searchRootColumn(context, root, scores, static_cast<uint8_t>(col));
+    });
+    if (context.isTimeOut) return;
+    _recordIteration(context.maxDepth);
+    context.deadline = deadline;
+
+    context.maxDepth = 42;
+    uint8_t order[7];
+    getRootOrder(scores, order);
+    ScoreArray solvedScores;
+    solvedScores.fill(NOT_SEARCHED);
+    _searchPool->parallelFor(7, [this, &context, &root, &solvedScores, &order](size_t i) {
+        const uint8_t col = order[i];
+        if (root.isColumnFull(col)) {
+            solvedScores[col] = MIN_SCORE;
             return;
         }
+
+        Position position(root);
+        position.playPlayer(col);
+
+        const ThreadCounters startCounters = _getThreadCounters();
+        int8_t score = position.getBoard().playerWins() ? context.getScore(1) : -_solve<OPPONENT>(context, position);
+        if (_isThinking) {
+            _addThreadCounters(startCounters);
+        }
+        if (context.isTimeOut) return;
+
+        solvedScores[col] = score;
+    });
+    if (context.isTimeOut) {
+        mergeInterruptedIteration(scores, solvedScores);
+        return;
     }
+    _recordIteration(context.maxDepth);
+
+    scores = solvedScores;
+}
+
+
+// Exact scores of every column from table (an opening book or endgame table), when it holds all the
+// positions they lead to
+template <typename Table>
+static bool getTableScores(const Table& table, const Board& board, uint8_t turnCount, Player::ScoreArray& scores) {
+    for (uint8_t col = 0; col < 7; ++col) {
+        if (board.isColumnFull(col)) {
+            scores[col] = MIN_SCORE;
+            continue;
+        }
+
+        Board newBoard = board;
+        newBoard.placePlayer(col);
+
+        if (newBoard.playerWins()) {
+            scores[col] = MAX_SCORE - static_cast<int8_t>(turnCount + 1);
+            continue;
+        }
+
+        // The opponent moves next, and tables are keyed by the stones of the side to move
+        int8_t score;
+        if (!table.probe(newBoard.getSwapped(), score)) {
+            return false;
+        }
+        scores[col] = -score;
+    }
+
+    return true;
+}
+
+
+bool Player::_getBookScores(ScoreArray& scores) const {
+    const OpeningBook& openingBook = _getOpeningBook();
+    if (!_useOpeningBook || !openingBook.isLoaded() || _turnCount + 1 > openingBook.getMaxPly()) {
+        return false;
+    }
+
+    return getTableScores(openingBook, _board, _turnCount, scores);
+}
+
+
+bool Player::_getEndgameScores(ScoreArray& scores) const {
+    const EndgameTable& endgameTable = _getEndgameTable();
+    if (!_useEndgameTable || _turnCount + 1 < endgameTable.getMinPly()) {
+        return false;
+    }
+
+    return getTableScores(endgameTable, _board, _turnCount, scores);
 }
 
 
 uint8_t Player::_chooseMove() {
     ScoreArray scores;
-    _getScores(scores);
+    if (!_getBookScores(scores) && !_getEndgameScores(scores) && !_getPonderScores(scores)) {
+        _getScores(scores);
+    }
 
     int8_t bestScore = MIN_SCORE;
     uint8_t bestScoreCount = 0;
@@ -378,35 +1007,51 @@ uint8_t Player::_chooseMove() {
 
 void Player::_reset(bool hardReset) {
     _endThreads = true;
+    // Pairs with the fence in _startSearchClock, so a search starting now cannot clear the time-out again
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _isTimeOut = true;
+    _stopPonder = true;
+    _waitForHostedTurns();
 
-    _timerCV.notify_one();
     _idleSearchCV.notify_one();
-    _gameCV.notify_one();
+    _notifyGameThread();
 
-    if (_timerThread.joinable()) _timerThread.join();
     if (_idleSearchThread.joinable()) _idleSearchThread.join();
     if (_gameThread.joinable()) _gameThread.join();
     _endThreads = false;
 
     _board.reset();
     _turnCount = 0;
+    _queuedOpponentMove.store(NO_QUEUED_MOVE, std::memory_order_release);
     _isTimeOut = false;
-    _runTimer = false;
-    _thinkingTimeMS.store(0, std::memory_order_release);
+    _stopPonder = false;
+    _pauseIdleSearch = false;
+    _ponderResults.clear();
+    _thinkingTimeNS.store(0, std::memory_order_release);
     _winner.store(NO_WINNER, std::memory_order_release);
 
     if (hardReset) {
-        _memoMutex.lock();
-        _memo.clear();
-        _memoMutex.unlock();
+        // Solved entries hold in any game, the rest depend on the previous game's search horizons.
+        // Deterministic games all start from the same empty memo.
+        if (_isDeterministic) {
+            _memo.clear();
+        } else {
+            _memo.clearUnsolved();
+        }
+        for (std::atomic<uint32_t>& history : _history) {
+            history.store(0, std::memory_order_relaxed);
+        }
     }
 }
 
 
 void Player::_applyPlayerMove() {
+    _beginSearchStats();
     uint8_t col = _chooseMove();
+    _endSearchStats(col);
     _board.placePlayer(col);
     _turnCount++;
+    _memo.setRootPly(_turnCount);
 }
 
 
@@ -417,58 +1062,171 @@ void Player::setDifficulty(Difficulty difficulty) {
 }
 
 
+void Player::setSearchThreads(uint8_t numThreads) {
+    if (_isPlaying || _host) return;
+
+    _numSearchThreads = std::min<uint8_t>(std::max<uint8_t>(numThreads, 1), 7);
+}
+
+
+bool Player::loadOpeningBook(const std::string& path) {
+    if (_isPlaying) return false;
+
+    return _openingBook.load(path);
+}
+
+
+bool Player::hasOpeningBook() const {
+    return _getOpeningBook().isLoaded();
+}
+
+
+const OpeningBook& Player::_getOpeningBook() const {
+    if (_host && !_openingBook.isLoaded()) {
+        return _host->getOpeningBook();
+    }
+    return _openingBook;
+}
+
+
+bool Player::loadEndgameTable(const std::string& path) {
+    if (_isPlaying) return false;
+
+    return _endgameTable.load(path);
+}
+
+
+bool Player::hasEndgameTable() const {
+    return _getEndgameTable().isLoaded();
+}
+
+
+const EndgameTable& Player::_getEndgameTable() const {
+    if (_host && !_endgameTable.isLoaded()) {
+        return _host->getEndgameTable();
+    }
+    return _endgameTable;
+}
+
+
+void Player::setDeterministic(bool isDeterministic, uint32_t seed, uint64_t maxNodes) {
+    if (_isPlaying) return;
+
+    _isDeterministic = isDeterministic;
+    _seed = seed;
+    _maxNodes = maxNodes;
+}
+
+
+void Player::setMemoBudgetBytes(size_t bytes) {
+    if (_isPlaying) return;
+
+    _memo.resize(bytes);
+}
+
+
+bool Player::saveMemoSnapshot(const std::string& path) const {
+    return _memo.saveSnapshot(path);
+}
+
+
+bool Player::loadMemoSnapshot(const std::string& path) {
+    if (_isPlaying) return false;
+
+    return _memo.loadSnapshot(path);
+}
+
+
 
 void Player::_applyDifficultySettings() {
     switch (_playerDifficulty) {
         case DIFFICULTY_0:
             _globalMaxDepth = 2;
             _maxThinkingTime = 1000;
+            _evaluation = EVALUATION_NONE;
             _allowIdleSearch = false;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
         case DIFFICULTY_1:
             _globalMaxDepth = 3;
             _maxThinkingTime = 1500;
+            _evaluation = EVALUATION_NONE;
             _allowIdleSearch = false;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
         case DIFFICULTY_2:
             _globalMaxDepth = 4;
             _maxThinkingTime = 2500;
+            _evaluation = EVALUATION_CENTER;
             _allowIdleSearch = false;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
         case DIFFICULTY_3:
             _globalMaxDepth = 5;
             _maxThinkingTime = 4000;
+            _evaluation = EVALUATION_CENTER;
             _allowIdleSearch = false;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
         case DIFFICULTY_4:
             _globalMaxDepth = 5;
             _maxThinkingTime = 4000;
+            _evaluation = EVALUATION_THREATS;
             _allowIdleSearch = true;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
         case DIFFICULTY_5:
             _globalMaxDepth = 6;
             _maxThinkingTime = 5000;
+            _evaluation = EVALUATION_THREATS;
             _allowIdleSearch = true;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
         case DIFFICULTY_6:
             _globalMaxDepth = 7;
             _maxThinkingTime = 7000;
+            _evaluation = EVALUATION_THREATS;
             _allowIdleSearch = true;
+            _useOpeningBook = true;
+            _useEndgameTable = true;
             break;
         case DIFFICULTY_7:
             _globalMaxDepth = 8;
             _maxThinkingTime = 10000;
+            _evaluation = EVALUATION_THREATS;
             _allowIdleSearch = true;
+            _useOpeningBook = true;
+            _useEndgameTable = true;
             break;
         case DIFFICULTY_8:
             _globalMaxDepth = 9;
             _maxThinkingTime = 15000;
+            _evaluation = EVALUATION_THREATS;
+            _allowIdleSearch = true;
+            _useOpeningBook = true;
+            _useEndgameTable = true;
+            break;
+        case DIFFICULTY_PERFECT:
+            _globalMaxDepth = 42;
+            _maxThinkingTime = 60000;
+            _evaluation = EVALUATION_THREATS;
             _allowIdleSearch = true;
+            _useOpeningBook = true;
+            _useEndgameTable = true;
             break;
         default:
             _globalMaxDepth = 4;
             _maxThinkingTime = 5000;
+            _evaluation = EVALUATION_CENTER;
             _allowIdleSearch = true;
+            _useOpeningBook = false;
+            _useEndgameTable = false;
             break;
     }
 }
@@ -483,82 +1241,175 @@ void Player::start(bool playerMovesFirst) {
     _reset(true);
     _applyDifficultySettings();
 
-    _timerThread = std::thread(&Player::_timerThreadFunc, this);
-    if (_allowIdleSearch) {
-        _idleSearchThread = std::thread(&Player::_idleSearchThreadFunc, this);
+    if (_isDeterministic) {
+        _rng.seed(_seed);
+    }
+
+    const uint8_t numSearchThreads = _isDeterministic ? 1 : _numSearchThreads;
+    if (!_searchPool || _searchPool->getNumThreads() != numSearchThreads) {
+        _searchPool.reset(new utils::ThreadPool(numSearchThreads - 1));
     }
 
     _isPlayerTurn = playerMovesFirst;
+
+    // Hosted players start no threads, their moves run on the host's pool
+    if (_host) {
+        if (playerMovesFirst) {
+            _scheduleHostedTurn();
+        }
+        return;
+    }
+
+    if (_allowIdleSearch && !_isDeterministic) {
+        _idleSearchThread = std::thread(&Player::_idleSearchThreadFunc, this);
+    }
+
     _gameThread = std::thread(&Player::_play, this);
 }
 
 
 void Player::_play() {
-    std::mutex gameMutex;
-    std::unique_lock<std::mutex> lock(gameMutex);
-
     while (!_endThreads) {
-        _gameCV.wait(lock, [this]() {return _isPlayerTurn || _endThreads;});
+        {
+            std::unique_lock<std::mutex> lock(_gameMutex);
+            _gameCV.wait(lock, [this]() {return _isPlayerTurn || _endThreads;});
+        }
 
         if (_endThreads) break;
 
         // Ensure the idle search thread is paused while the player is making a move
         _pauseIdleSearch = true;
-        std::lock_guard<std::mutex> idleLock(_idleSearchMutex);
+        _stopPonder = true;
+        std::unique_lock<std::mutex> idleLock(_idleSearchMutex);
 
-        // Check if game is over (opponent won or draw)
-        if (_board.opponentWins()) {
-            _winner.store(OPPONENT_WINS, std::memory_order_release);
-            break;
-        } else if (_board.isDraw()) {
-            _winner.store(DRAW, std::memory_order_release);
-            break;
-        }
+        _applyQueuedOpponentMove();
+        if (!_takeTurn()) break;
 
-        _applyPlayerMove();
+        // Ponder until the opponent replies
+        _pauseIdleSearch = false;
+        idleLock.unlock();
+        _idleSearchCV.notify_one();
+    }
+
+    _isPlaying = false;
+}
 
-        // Check if game is over (player won or draw)
-        if (_board.playerWins()) {
-            _winner.store(PLAYER_WINS, std::memory_order_release);
-            break;
-        } else if (_board.isDraw()) {
-            _winner.store(DRAW, std::memory_order_release);
-            break;
-        }
 
-        _isPlayerTurn = false;
+// Taking _gameMutex orders the notification after the game thread's wait, so it cannot be missed
+void Player::_notifyGameThread() {
+    {
+        std::lock_guard<std::mutex> lock(_gameMutex);
     }
+    _gameCV.notify_one();
+}
 
-    _isPlaying = false;
+
+// Applies the move queued by applyOpponentMove, if the player's turn follows one
+void Player::_applyQueuedOpponentMove() {
+    const uint8_t col = _queuedOpponentMove.load(std::memory_order_acquire);
+    if (col == NO_QUEUED_MOVE) {
+        return;
+    }
+
+    _board.placeOpponent(col);
+    _turnCount++;
+    _memo.setRootPly(_turnCount);
+}
+
+
+// Plays the player's move, returns false once the game is over
+bool Player::_takeTurn() {
+    // Check if game is over (opponent won or draw)
+    if (_board.opponentWins()) {
+        _winner.store(OPPONENT_WINS, std::memory_order_release);
+        return false;
+    } else if (_board.isDraw()) {
+        _winner.store(DRAW, std::memory_order_release);
+        return false;
+    }
+
+    _applyPlayerMove();
+
+    // Check if game is over (player won or draw)
+    if (_board.playerWins()) {
+        _winner.store(PLAYER_WINS, std::memory_order_release);
+        return false;
+    } else if (_board.isDraw()) {
+        _winner.store(DRAW, std::memory_order_release);
+        return false;
+    }
+
+    // Pondering is allowed again before the opponent can move, so the stop of their next move always holds
+    _stopPonder = false;
+    _queuedOpponentMove.store(NO_QUEUED_MOVE, std::memory_order_release);
+    _isPlayerTurn = false;
+    return true;
+}
+
+
+void Player::_scheduleHostedTurn() {
+    {
+        std::lock_guard<std::mutex> lock(_hostedTurnMutex);
+        _numHostedTurns++;
+    }
+
+    _host->_submit([this]() {
+        if (!_endThreads) {
+            _applyQueuedOpponentMove();
+            if (!_takeTurn()) {
+                _isPlaying = false;
+            }
+        }
+
+        // Last access to the player, which may be destroyed as soon as the count drops
+        std::lock_guard<std::mutex> lock(_hostedTurnMutex);
+        _numHostedTurns--;
+        _hostedTurnCV.notify_all();
+    });
+}
+
+
+// Waits for scheduled moves to finish, _endThreads makes those not started yet return at once
+void Player::_waitForHostedTurns() {
+    std::unique_lock<std::mutex> lock(_hostedTurnMutex);
+    _hostedTurnCV.wait(lock, [this]() {return _numHostedTurns == 0;});
 }
 
 
 
 bool Player::applyOpponentMove(uint8_t col) {
     // Can't apply opponent move if the game is not active or it's currently the player's turn
-    if (!_isPlaying || _isPlayerTurn) {
+    if (!_isPlaying || _isPlayerTurn || col > 6) {
         return false;
     }
 
-    // Ensure the idle search thread is paused while the opponent is making a move
-    _pauseIdleSearch = true;
-    std::lock_guard<std::mutex> idleLock(_idleSearchMutex);
+    // Taking the slot makes this the only call queuing a move this turn, and the board cannot change until
+    // the player's turn starts below
+    uint8_t noMove = NO_QUEUED_MOVE;
+    if (!_queuedOpponentMove.compare_exchange_strong(noMove, col, std::memory_order_acq_rel)) {
+        return false;
+    }
 
     // Can't apply move to a full column
-    if (_board.isColumnFull(col)) {
+    if (_isPlayerTurn || _board.isColumnFull(col)) {
+        _queuedOpponentMove.store(NO_QUEUED_MOVE, std::memory_order_release);
         return false;
     }
 
-    _board.placeOpponent(col);
-    _turnCount++;
+    // Pondering stops within a few nodes, the game thread waits for it rather than the caller
     _isPlayerTurn = true;
-    _gameCV.notify_one();
+    _stopPonder = true;
+
+    if (_host) {
+        _scheduleHostedTurn();
+    } else {
+        _notifyGameThread();
+    }
 
     return true;
 }
 
 
 size_t Player::getMemoSize() const {
-    std::lock_guard<std::mutex> lock(_memoMutex);
-    return _memo.size();
+    return _memo.getUsed();
 }
@@ -0,0 +1,279 @@
+#include <connect4/transposition_table.h>
+#include <connect4/board.h>
+#include <utils/mapped_file.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace connect4;
+
+
+constexpr char TranspositionTable::SNAPSHOT_MAGIC[4];
+
+
+#if CONNECT4_SEARCH_STATS
+// Probes and stores of the calling thread, on whichever table it searched
+static thread_local TranspositionTable::Counters threadCounters;
+#endif
+
+
+TranspositionTable::TranspositionTable(size_t sizeBytes) {
+    resize(sizeBytes);
+}
+
+
+void TranspositionTable::resize(size_t sizeBytes) {
+    // Round down to a power of two number of buckets so the index is a mask
+    size_t numBuckets = 1;
+    while (numBuckets * 2 * sizeof(Bucket) <= sizeBytes) {
+        numBuckets *= 2;
+    }
+
+    if (_buckets && numBuckets == _bucketMask + 1) {
+        clear();
+        return;
+    }
+
+    _buckets.reset(new Bucket[numBuckets]);
+    _bucketMask = numBuckets - 1;
+    _resetStats();
+}
+
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i <= _bucketMask; ++i) {
+        for (Slot& slot : _buckets[i].slots) {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    _resetStats();
+}
+
+
+void TranspositionTable::clearUnsolved() {
+    size_t used = 0;
+    for (size_t i = 0; i <= _bucketMask; ++i) {
+        for (Slot& slot : _buckets[i].slots) {
+            const uint64_t data = slot.data.load(std::memory_order_relaxed);
+            if (data != 0 && _unpack(data).depth == DEPTH_SOLVED) {
+                used++;
+                continue;
+            }
+
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    _resetStats();
+    _used.store(used, std::memory_order_relaxed);
+}
+
+
+void TranspositionTable::_resetStats() {
+    _rootPly.store(0, std::memory_order_relaxed);
+    _used.store(0, std::memory_order_relaxed);
+    _probes.store(0, std::memory_order_relaxed);
+    _hits.store(0, std::memory_order_relaxed);
+    _stores.store(0, std::memory_order_relaxed);
+    _evictions.store(0, std::memory_order_relaxed);
+    _collisions.store(0, std::memory_order_relaxed);
+}
+
+
+// Fibonacci hashing: one multiply spreads the 49 key bits over the high half of the product
+inline TranspositionTable::Bucket& TranspositionTable::_getBucket(uint64_t key) const {
+    return _buckets[((key * 0x9e3779b97f4a7c15ULL) >> 32) & _bucketMask];
+}
+
+
+bool TranspositionTable::probe(uint64_t key, SearchResult& result) const {
+#if CONNECT4_SEARCH_STATS
+    threadCounters.probes++;
+    bool isFull = true;
+#endif
+
+    const Bucket& bucket = _getBucket(key);
+    for (const Slot& slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && data != 0) {
+#if CONNECT4_SEARCH_STATS
+            threadCounters.hits++;
+#endif
+            result = _unpack(data);
+            return true;
+        }
+#if CONNECT4_SEARCH_STATS
+        isFull &= data != 0;
+#endif
+    }
+
+#if CONNECT4_SEARCH_STATS
+    threadCounters.collisions += isFull;
+#endif
+    return false;
+}
+
+
+void TranspositionTable::store(uint64_t key, uint8_t ply, const SearchResult& result) {
+    Bucket& bucket = _getBucket(key);
+    const uint64_t newData = _pack(result, ply);
+    const uint8_t rootPly = _rootPly.load(std::memory_order_relaxed);
+
+    // Reuse the slot holding this key, else an empty slot, else one holding a position that can
+    // no longer be reached, else evict the entry that was searched the shallowest
+    Slot* target = nullptr;
+    uint8_t targetDepth = 0xFF;
+    bool isFree = false;
+    bool isEmpty = false;
+    bool isSameKey = false;
+    for (Slot& slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+        if ((check ^ data) == key && data != 0) {
+            // Keep a deeper result for the same position
+            if (_unpack(data).depth > result.depth) {
+                return;
+            }
+            target = &slot;
+            isSameKey = true;
+            break;
+        }
+
+        if (isEmpty) {
+            continue;
+        }
+
+        if (data == 0) {
+            target = &slot;
+            isFree = true;
+            isEmpty = true;
+        } else if (_unpackPly(data) < rootPly) {
+            if (!isFree) {
+                target = &slot;
+                isFree = true;
+            }
+        } else if (!isFree && _unpack(data).depth < targetDepth) {
+            target = &slot;
+            targetDepth = _unpack(data).depth;
+        }
+    }
+
+#if CONNECT4_SEARCH_STATS
+    threadCounters.stores++;
+    threadCounters.evictions += !isSameKey && !isEmpty && !isFree;
+#endif
+    // Claim an empty slot with a compare-exchange, so threads racing for the same slot count it once
+    uint64_t empty = 0;
+    if (!isSameKey && isEmpty && target->data.compare_exchange_strong(empty, newData, std::memory_order_relaxed)) {
+        _used.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        target->data.store(newData, std::memory_order_relaxed);
+    }
+    target->check.store(key ^ newData, std::memory_order_relaxed);
+}
+
+
+TranspositionTable::Stats TranspositionTable::getStats() const {
+    Stats stats;
+    stats.sizeBytes = getSizeBytes();
+    stats.capacity = getCapacity();
+    stats.used = _used.load(std::memory_order_relaxed);
+    stats.probes = _probes.load(std::memory_order_relaxed);
+    stats.hits = _hits.load(std::memory_order_relaxed);
+    stats.stores = _stores.load(std::memory_order_relaxed);
+    stats.evictions = _evictions.load(std::memory_order_relaxed);
+    stats.collisions = _collisions.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+TranspositionTable::Counters TranspositionTable::getThreadCounters() {
+#if CONNECT4_SEARCH_STATS
+    return threadCounters;
+#else
+    return Counters();
+#endif
+}
+
+
+void TranspositionTable::addThreadCounters(const Counters& start) {
+#if CONNECT4_SEARCH_STATS
+    _probes.fetch_add(threadCounters.probes - start.probes, std::memory_order_relaxed);
+    _hits.fetch_add(threadCounters.hits - start.hits, std::memory_order_relaxed);
+    _stores.fetch_add(threadCounters.stores - start.stores, std::memory_order_relaxed);
+    _evictions.fetch_add(threadCounters.evictions - start.evictions, std::memory_order_relaxed);
+    _collisions.fetch_add(threadCounters.collisions - start.collisions, std::memory_order_relaxed);
+#else
+    (void)start;
+#endif
+}
+
+
+bool TranspositionTable::saveSnapshot(const std::string& path) const {
+    std::vector<uint64_t> entries;
+    for (size_t i = 0; i <= _bucketMask; ++i) {
+        for (const Slot& slot : _buckets[i].slots) {
+            const uint64_t data = slot.data.load(std::memory_order_relaxed);
+            const uint64_t key = slot.check.load(std::memory_order_relaxed) ^ data;
+            if (data == 0 || key > SNAPSHOT_KEY_MASK) {
+                continue;
+            }
+
+            const SearchResult result = _unpack(data);
+            if (result.flag != EXACT || result.depth != DEPTH_SOLVED) {
+                continue;
+            }
+
+            entries.push_back(key | (static_cast<uint64_t>(_unpackPly(data)) << 49) | (static_cast<uint64_t>(static_cast<uint8_t>(result.score)) << 56));
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.numEntries = entries.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(uint64_t)));
+
+    return static_cast<bool>(file);
+}
+
+
+bool TranspositionTable::loadSnapshot(const std::string& path) {
+    utils::MappedFile file;
+    if (!file.open(path) || file.getSize() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, file.getData(), sizeof(SnapshotHeader));
+    // The entry count is bounded by the file size first, so a damaged count cannot wrap the size check
+    const size_t maxEntries = (file.getSize() - sizeof(SnapshotHeader)) / sizeof(uint64_t);
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION
+            || header.numEntries > maxEntries || file.getSize() != sizeof(SnapshotHeader) + header.numEntries * sizeof(uint64_t)) {
+        return false;
+    }
+
+    const uint64_t* entries = reinterpret_cast<const uint64_t*>(file.getData() + sizeof(SnapshotHeader));
+    for (uint64_t i = 0; i < header.numEntries; ++i) {
+        const uint64_t entry = entries[i];
+
+        SearchResult result;
+        result.score = static_cast<int8_t>(entry >> 56);
+        result.flag = EXACT;
+        result.depth = DEPTH_SOLVED;
+        store(entry & SNAPSHOT_KEY_MASK, static_cast<uint8_t>((entry >> 49) & 0x7F), result);
+    }
+
+    return true;
+}
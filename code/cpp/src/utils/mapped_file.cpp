@@ -0,0 +1,108 @@
+#include <utils/mapped_file.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace utils;
+
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    _fileHandle = file;
+    _mappingHandle = mapping;
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+
+void MappedFile::close() {
+    if (_data) UnmapViewOfFile(_data);
+    if (_mappingHandle) CloseHandle(_mappingHandle);
+    if (_fileHandle) CloseHandle(_fileHandle);
+
+    _data = nullptr;
+    _size = 0;
+    _fileHandle = nullptr;
+    _mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+
+void MappedFile::close() {
+    if (_data) {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
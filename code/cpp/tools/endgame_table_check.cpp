@@ -0,0 +1,129 @@
+// Checks that searches using an endgame table rank its proven wins above the horizon evaluation.
+//
+// Each test position has a move winning late in the endgame, within the range of the threat evaluation at a
+// shallow horizon, and a drawn or lost move the evaluation scores higher. The position is analyzed with a table
+// holding only the positions two plies after the winning move, as a table sampled from other games would, and
+// the winning move has to be ranked first.
+//
+// Usage: endgame_table_check [search depth]
+// Returns 0 when every position passes.
+
+#include <connect4/board.h>
+#include <connect4/endgame_table.h>
+#include <connect4/player.h>
+#include <utils/bits.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace connect4;
+
+
+// Columns played from the empty board (1 to 7)
+static const char* const TEST_POSITIONS[] = {
+    "5673335242443651354557",
+    "317221342211212153655747",
+    "364236326551456257567323"
+};
+
+// Central columns first, the order the player breaks ties in
+static constexpr uint8_t COLUMN_ORDER[7] = {3, 2, 4, 1, 5, 0, 6};
+
+
+// Board with the stones of the side to move as the player stones
+static Board parsePosition(const char* moves) {
+    Board board;
+    for (const char* move = moves; *move; ++move) {
+        board.placePlayer(static_cast<uint8_t>(*move - '1'));
+        board = board.getSwapped();
+    }
+    return board;
+}
+
+
+static uint8_t getBestColumn(const Player::ScoreArray& scores) {
+    uint8_t bestCol = COLUMN_ORDER[0];
+    for (uint8_t col : COLUMN_ORDER) {
+        if (scores[col] > scores[bestCol]) {
+            bestCol = col;
+        }
+    }
+    return bestCol;
+}
+
+
+// Writes the exact scores of the positions two plies after col on board
+static bool writeTable(Player& solver, const Board& board, uint8_t col, const std::string& path) {
+    Board reply = board;
+    reply.placePlayer(col);
+    reply = reply.getSwapped();
+
+    std::vector<std::pair<uint64_t, int8_t>> entries;
+    for (uint8_t replyCol = 0; replyCol < 7; ++replyCol) {
+        if (reply.isColumnFull(replyCol)) {
+            continue;
+        }
+
+        Board next = reply;
+        next.placePlayer(replyCol);
+        if (!next.playerWins() && !next.isDraw()) {
+            bool isMirrored;
+            next = next.getSwapped();
+            entries.emplace_back(next.getCanonicalKey(isMirrored), solver.solve(next));
+        }
+    }
+
+    const uint8_t ply = static_cast<uint8_t>(utils::popCount(board.getTotalBoard()));
+    return EndgameTable::write(path, static_cast<uint8_t>(42 - (ply + 2)), std::move(entries));
+}
+
+
+int main(int argc, char** argv) {
+    const uint8_t depth = static_cast<uint8_t>(argc > 1 ? std::atoi(argv[1]) : 4);
+
+    std::random_device random;
+    const std::string path = (std::filesystem::temp_directory_path() / ("endgame_table_check_" + std::to_string(random()) + ".bin")).string();
+
+    Player solver;
+    int numFailed = 0;
+    for (const char* moves : TEST_POSITIONS) {
+        const Board board = parsePosition(moves);
+
+        int8_t exactScores[7];
+        uint8_t winningCol = COLUMN_ORDER[0];
+        for (uint8_t col : COLUMN_ORDER) {
+            exactScores[col] = MIN_SCORE;
+            if (!board.isColumnFull(col)) {
+                Board child = board;
+                child.placePlayer(col);
+                exactScores[col] = child.playerWins() ? MAX_SCORE : static_cast<int8_t>(-solver.solve(child.getSwapped()));
+            }
+            if (exactScores[col] > exactScores[winningCol]) {
+                winningCol = col;
+            }
+        }
+
+        bool isPassed = false;
+        uint8_t chosenCol = winningCol;
+        if (exactScores[winningCol] > 0 && writeTable(solver, board, winningCol, path)) {
+            // The player unmaps the table before the file is removed
+            Player player;
+            if (player.loadEndgameTable(path)) {
+                chosenCol = getBestColumn(player.analyze({board}, depth, 0, 1)[0]);
+                isPassed = exactScores[chosenCol] > 0;
+            }
+        }
+        std::remove(path.c_str());
+
+        std::printf("%s %s: winning move %u, chosen %u\n", isPassed ? "ok  " : "FAIL", moves,
+            static_cast<unsigned>(winningCol + 1), static_cast<unsigned>(chosenCol + 1));
+        numFailed += !isPassed;
+    }
+
+    return numFailed == 0 ? 0 : 1;
+}
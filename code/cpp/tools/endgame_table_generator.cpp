@@ -0,0 +1,151 @@
+// Builds an endgame table of exact scores for positions with at most a given number of empty cells.
+//
+// Every such position is far too many to solve (over 10^11 with a single empty cell), so the table covers
+// the endgames of sampled games: each game is played out at random, never giving away an immediate win,
+// until few enough cells are left, and every position reachable from there is solved.
+//
+// Usage: endgame_table_generator <output file> <max empty cells> <games> [seed] [memo MiB]
+
+#include <connect4/board.h>
+#include <connect4/endgame_table.h>
+#include <connect4/player.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace connect4;
+
+
+struct TablePosition {
+    Board board;
+    uint8_t ply;
+};
+
+
+// Plays a game from the empty board with the player stones as the first mover's, picking uniformly among the moves
+// that neither hand the other side a win nor miss one. Returns false when the game is decided before minPly.
+static bool playRandomGame(std::mt19937& rng, uint8_t minPly, Board& board) {
+    board = Board();
+    for (uint8_t ply = 0; ply < minPly; ++ply) {
+        const Board toMove = ply % 2 == 0 ? board : board.getSwapped();
+        if (toMove.getPossibleMoves() & toMove.getPlayerWinningCells()) {
+            return false;
+        }
+
+        uint64_t moves = toMove.getPlayerNonLosingMoves();
+        if (!moves) {
+            return false;
+        }
+
+        uint8_t cols[7];
+        uint8_t numCols = 0;
+        for (uint8_t col = 0; col < 7; ++col) {
+            if (moves & Board::columnMask(col)) {
+                cols[numCols++] = col;
+            }
+        }
+
+        const uint8_t col = cols[std::uniform_int_distribution<int>(0, numCols - 1)(rng)];
+        if (ply % 2 == 0) {
+            board.placePlayer(col);
+        } else {
+            board.placeOpponent(col);
+        }
+    }
+    return true;
+}
+
+
+// Collects every distinct position (up to mirroring) reachable from board that is not already decided.
+// Boards are stored with the stones of the side to move as the player stones.
+static void collectPositions(const Board& board, uint8_t ply, std::unordered_set<uint64_t>& seen, std::vector<TablePosition>& positions) {
+    // The first mover's stones are the player stones of board
+    const Board toMove = ply % 2 == 0 ? board : board.getSwapped();
+    if (toMove.opponentWins() || toMove.isDraw()) {
+        return;
+    }
+
+    bool isMirrored;
+    if (!seen.insert(toMove.getCanonicalKey(isMirrored)).second) {
+        return;
+    }
+    positions.push_back({toMove, ply});
+
+    for (uint8_t col = 0; col < 7; ++col) {
+        if (board.isColumnFull(col)) {
+            continue;
+        }
+
+        Board newBoard = board;
+        if (ply % 2 == 0) {
+            newBoard.placePlayer(col);
+        } else {
+            newBoard.placeOpponent(col);
+        }
+        collectPositions(newBoard, ply + 1, seen, positions);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::fprintf(stderr, "Usage: %s <output file> <max empty cells> <games> [seed] [memo MiB]\n", argv[0]);
+        return 1;
+    }
+
+    const char* outputPath = argv[1];
+    const uint8_t maxEmptyCells = static_cast<uint8_t>(std::min(std::max(std::atoi(argv[2]), 1), 41));
+    const int numGames = std::atoi(argv[3]);
+    const unsigned int seed = argc > 4 ? static_cast<unsigned int>(std::strtoul(argv[4], nullptr, 10)) : 1;
+    const size_t memoMiB = argc > 5 ? static_cast<size_t>(std::atoi(argv[5])) : 256;
+
+    const uint8_t minPly = 42 - maxEmptyCells;
+    std::mt19937 rng(seed);
+
+    std::unordered_set<uint64_t> seen;
+    std::vector<TablePosition> positions;
+    for (int i = 0; i < numGames; ++i) {
+        Board board;
+        if (playRandomGame(rng, minPly, board)) {
+            collectPositions(board, minPly, seen, positions);
+        }
+    }
+
+    // Deepest positions first, so shallower solves find their subtrees in the memo
+    std::stable_sort(positions.begin(), positions.end(), [](const TablePosition& a, const TablePosition& b) {
+        return a.ply > b.ply;
+    });
+    std::fprintf(stderr, "Solving %zu positions with at most %u empty cells\n", positions.size(), static_cast<unsigned>(maxEmptyCells));
+
+    Player player;
+    player.setMemoBudgetBytes(memoMiB * 1024 * 1024);
+
+    std::vector<std::pair<uint64_t, int8_t>> entries;
+    entries.reserve(positions.size());
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const Board& board = positions[i].board;
+
+        bool isMirrored;
+        entries.emplace_back(board.getCanonicalKey(isMirrored), player.solve(board));
+
+        if ((i + 1) % 100000 == 0 || i + 1 == positions.size()) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            std::fprintf(stderr, "%zu / %zu positions, %.1f s\n", i + 1, positions.size(), seconds);
+        }
+    }
+
+    if (!EndgameTable::write(outputPath, maxEmptyCells, std::move(entries))) {
+        std::fprintf(stderr, "Failed to write %s\n", outputPath);
+        return 1;
+    }
+
+    return 0;
+}
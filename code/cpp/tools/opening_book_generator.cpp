@@ -0,0 +1,106 @@
+// Builds an opening book of exact scores for every position up to a given number of plies.
+//
+// Usage: opening_book_generator <output file> <max plies> [memo MiB]
+
+#include <connect4/board.h>
+#include <connect4/opening_book.h>
+#include <connect4/player.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace connect4;
+
+
+struct BookPosition {
+    Board board;
+    uint8_t ply;
+};
+
+
+// Collects every distinct position (up to mirroring) reachable in at most maxPly moves that is not already decided.
+// Boards are stored with the stones of the side to move as the player stones.
+static void collectPositions(const Board& board, uint8_t ply, uint8_t maxPly, std::unordered_set<uint64_t>& seen, std::vector<BookPosition>& positions) {
+    // The first mover's stones are the player stones of board
+    const Board toMove = ply % 2 == 0 ? board : board.getSwapped();
+    if (toMove.opponentWins() || toMove.isDraw()) {
+        return;
+    }
+
+    bool isMirrored;
+    if (!seen.insert(toMove.getCanonicalKey(isMirrored)).second) {
+        return;
+    }
+    positions.push_back({toMove, ply});
+
+    if (ply == maxPly) {
+        return;
+    }
+
+    for (uint8_t col = 0; col < 7; ++col) {
+        if (board.isColumnFull(col)) {
+            continue;
+        }
+
+        Board newBoard = board;
+        if (ply % 2 == 0) {
+            newBoard.placePlayer(col);
+        } else {
+            newBoard.placeOpponent(col);
+        }
+        collectPositions(newBoard, ply + 1, maxPly, seen, positions);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s <output file> <max plies> [memo MiB]\n", argv[0]);
+        return 1;
+    }
+
+    const char* outputPath = argv[1];
+    const uint8_t maxPly = static_cast<uint8_t>(std::min(std::atoi(argv[2]), 41));
+    const size_t memoMiB = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 256;
+
+    std::unordered_set<uint64_t> seen;
+    std::vector<BookPosition> positions;
+    collectPositions(Board(), 0, maxPly, seen, positions);
+
+    // Deepest positions first, so shallower solves find their subtrees in the memo
+    std::stable_sort(positions.begin(), positions.end(), [](const BookPosition& a, const BookPosition& b) {
+        return a.ply > b.ply;
+    });
+    std::fprintf(stderr, "Solving %zu positions up to ply %u\n", positions.size(), static_cast<unsigned>(maxPly));
+
+    Player player;
+    player.setMemoBudgetBytes(memoMiB * 1024 * 1024);
+
+    std::vector<std::pair<uint64_t, int8_t>> entries;
+    entries.reserve(positions.size());
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const Board& board = positions[i].board;
+
+        bool isMirrored;
+        entries.emplace_back(board.getCanonicalKey(isMirrored), player.solve(board));
+
+        if ((i + 1) % 1000 == 0 || i + 1 == positions.size()) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            std::fprintf(stderr, "%zu / %zu positions, %.1f s\n", i + 1, positions.size(), seconds);
+        }
+    }
+
+    if (!OpeningBook::write(outputPath, maxPly, std::move(entries))) {
+        std::fprintf(stderr, "Failed to write %s\n", outputPath);
+        return 1;
+    }
+
+    return 0;
+}